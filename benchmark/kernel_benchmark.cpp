@@ -0,0 +1,185 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/definitions.h"
+#include "../src/partition_util.h"
+#include "../src/topology.h"
+
+using namespace ProMapAnalyzer;
+
+/**
+ * Compares the stats kernel on the runtime hierarchy (determine_distance),
+ * on DynamicTopology and on the StaticTopology of each depth from 1 to
+ * MAX_STATIC_DEPTH + 1. Every level of the hierarchy has 4 groups.
+ * runtime/dynamic is the gain of the layer search by strides over
+ * determine_distance, dynamic/static the gain of the specialization on the
+ * depth alone.
+ *
+ * The synthetic graph has n vertices of degree deg, the partition assigns
+ * consecutive vertices to the same block. Most neighbors are close to the
+ * vertex, so most cut edges are cut on low layers as in a good mapping.
+ */
+
+struct Csr {
+    u64 n = 0;
+    std::vector<u64> neighborhoods;
+    std::vector<vertex_t> edges_v;
+    std::vector<weight_t> edges_w;
+};
+
+Csr generate_graph(const u64 n,
+                   const u64 deg,
+                   const u64 seed) {
+    Csr g;
+    g.n = n;
+    g.neighborhoods.resize(n + 1);
+    g.edges_v.resize(n * deg);
+    g.edges_w.resize(n * deg);
+
+    std::mt19937_64 rng(seed);
+    std::geometric_distribution<u64> offset(1.0 / 256.0);
+    std::uniform_int_distribution<u64> any(0, n - 1);
+    std::uniform_int_distribution<u64> weight(1, 10);
+    std::uniform_int_distribution<u64> coin(0, 9);
+
+    for (u64 u = 0; u < n; ++u) {
+        g.neighborhoods[u] = u * deg;
+        for (u64 i = 0; i < deg; ++i) {
+            const u64 v = coin(rng) == 0 ? any(rng) : (u + 1 + offset(rng)) % n;
+            g.edges_v[u * deg + i] = v;
+            g.edges_w[u * deg + i] = weight(rng);
+        }
+    }
+    g.neighborhoods[n] = n * deg;
+    return g;
+}
+
+/**
+ * The kernel as it was before the specialization, kept as the baseline.
+ */
+Stats runtime_kernel(const Csr &g,
+                     const std::vector<u64> &partition,
+                     const std::vector<u64> &hierarchy,
+                     const std::vector<u64> &distance,
+                     const u64 k) {
+    Stats stats(hierarchy.size());
+    std::vector<u64> loc_distance(hierarchy.size());
+    std::iota(loc_distance.begin(), loc_distance.end(), 0);
+    std::vector<u64> u_loc(hierarchy.size());
+    std::vector<u64> v_loc(hierarchy.size());
+
+    for (u64 u = 0; u < g.n; ++u) {
+        const u64 u_id = partition[u];
+        for (u64 idx = g.neighborhoods[u]; idx < g.neighborhoods[u + 1]; ++idx) {
+            const u64 v_id = partition[g.edges_v[idx]];
+            const u64 weight = g.edges_w[idx];
+            if (u_id != v_id) {
+                const u64 u_v_distance = determine_distance(u_id, v_id, k, hierarchy, distance, u_loc, v_loc);
+                const u64 d = determine_distance(u_id, v_id, k, hierarchy, loc_distance, u_loc, v_loc);
+                stats.edge_cut += 1;
+                stats.edge_cut_layer[d] += 1;
+                stats.weighted_edge_cut += weight;
+                stats.weighted_edge_cut_layer[d] += weight;
+                stats.comm_cost += weight * u_v_distance;
+                stats.comm_cost_layer[d] += weight * u_v_distance;
+            }
+        }
+    }
+    return stats;
+}
+
+template<typename Topology>
+Stats topology_kernel(const Csr &g,
+                      const std::vector<u64> &partition,
+                      const Topology &topology) {
+    Stats stats(topology.depth());
+    accumulate_stats(g.neighborhoods.data(), g.edges_v.data(), g.edges_w.data(), 0, 0, g.n, partition, topology, stats);
+    return stats;
+}
+
+bool same(const Stats &a,
+          const Stats &b) {
+    return a.edge_cut == b.edge_cut && a.weighted_edge_cut == b.weighted_edge_cut && a.comm_cost == b.comm_cost &&
+           a.edge_cut_layer == b.edge_cut_layer && a.weighted_edge_cut_layer == b.weighted_edge_cut_layer &&
+           a.comm_cost_layer == b.comm_cost_layer;
+}
+
+/**
+ * Best time of reps runs in seconds.
+ */
+template<typename F>
+f64 best_time(const u64 reps,
+              F &&f,
+              Stats &result) {
+    f64 best = 1e300;
+    for (u64 r = 0; r < reps; ++r) {
+        auto sp = std::chrono::steady_clock::now();
+        result = f();
+        auto ep = std::chrono::steady_clock::now();
+        best = std::min(best, (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep - sp).count() / 1e9);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const u64 n = argc > 1 ? std::stoull(argv[1]) : 1 << 20;
+    const u64 deg = argc > 2 ? std::stoull(argv[2]) : 16;
+    const u64 reps = argc > 3 ? std::stoull(argv[3]) : 5;
+
+    const Csr g = generate_graph(n, deg, 0);
+    std::cout << "n=" << n << " m=" << n * deg << " reps=" << reps << "\n";
+    std::cout << std::setw(6) << "depth" << std::setw(8) << "k"
+              << std::setw(14) << "runtime [s]" << std::setw(14) << "dynamic [s]" << std::setw(14) << "static [s]"
+              << std::setw(16) << "runtime/dynamic" << std::setw(16) << "dynamic/static" << "\n";
+
+    bool all_same = true;
+    for (u64 depth = 1; depth <= MAX_STATIC_DEPTH + 1; ++depth) {
+        std::vector<u64> hierarchy(depth, 4);
+        std::vector<u64> distance(depth);
+        for (u64 l = 0; l < depth; ++l) { distance[l] = l == 0 ? 1 : distance[l - 1] * 10; }
+        const u64 k = prod<u64>(hierarchy);
+
+        std::vector<u64> partition(n);
+        for (u64 u = 0; u < n; ++u) { partition[u] = u * k / n; }
+
+        Stats a, b, c;
+        const f64 t_runtime = best_time(reps, [&]() { return runtime_kernel(g, partition, hierarchy, distance, k); }, a);
+        const f64 t_dynamic = best_time(reps, [&]() { return topology_kernel(g, partition, DynamicTopology(hierarchy, distance)); }, b);
+        const f64 t_static = best_time(reps, [&]() {
+            return with_topology(hierarchy, distance, [&](const auto &topology) { return topology_kernel(g, partition, topology); });
+        }, c);
+        all_same &= same(a, b) && same(a, c);
+
+        std::cout << std::setw(6) << depth << std::setw(8) << k << std::fixed << std::setprecision(4)
+                  << std::setw(14) << t_runtime << std::setw(14) << t_dynamic << std::setw(14) << t_static
+                  << std::setprecision(2) << std::setw(15) << t_runtime / t_dynamic << "x" << std::setw(15) << t_dynamic / t_static << "x"
+                  << (depth > MAX_STATIC_DEPTH ? "  (generic)" : "") << "\n";
+    }
+
+    if (!all_same) {
+        std::cout << "Kernels do not agree!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/definitions.h"
+#include "../src/graph.h"
+#include "../src/tokenizer.h"
+
+using namespace ProMapAnalyzer;
+
+/**
+ * Compares the bytewise METIS vertex-line parser against the vectorized
+ * one (parse_metis_vertex) on a synthetic graph file held in memory, with
+ * and without edge weights. Both fill preallocated CSR arrays, so neither
+ * file access nor allocation is measured, only tokenizing and storing.
+ *
+ * The synthetic graph has n vertices of degree deg. Most neighbors are
+ * close to the vertex, the ids have as many digits as in a real file of
+ * that size.
+ */
+
+std::string generate_metis(const u64 n,
+                           const u64 deg,
+                           const bool weighted,
+                           const u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::geometric_distribution<u64> offset(1.0 / 256.0);
+    std::uniform_int_distribution<u64> any(0, n - 1);
+    std::uniform_int_distribution<u64> weight(1, 100);
+    std::uniform_int_distribution<u64> coin(0, 9);
+
+    std::string s = std::to_string(n) + " " + std::to_string(n * deg / 2) + (weighted ? " 1" : "") + "\n";
+    for (u64 u = 0; u < n; ++u) {
+        for (u64 i = 0; i < deg; ++i) {
+            const u64 v = coin(rng) == 0 ? any(rng) : (u + 1 + offset(rng)) % n;
+            if (i > 0) { s += ' '; }
+            s += std::to_string(v + 1);
+            if (weighted) {
+                s += ' ';
+                s += std::to_string(weight(rng));
+            }
+        }
+        s += '\n';
+    }
+    return s;
+}
+
+struct Csr {
+    std::vector<u64> neighborhoods;
+    std::vector<vertex_t> edges_v;
+    std::vector<weight_t> edges_w;
+
+    bool operator==(const Csr &other) const {
+        return neighborhoods == other.neighborhoods && edges_v == other.edges_v && edges_w == other.edges_w;
+    }
+};
+
+/**
+ * The vertex-line parser as it was before the vectorization, one byte at a
+ * time, kept as the baseline.
+ */
+template<typename F>
+const char *parse_metis_vertex_bytewise(const char *p,
+                                        const char *end,
+                                        const MetisHeader &h,
+                                        F &&add_edge) {
+    p = skip_spaces(p, end);
+    while (p < end && *p != '\n') {
+        const vertex_t v = parse_uint(p, end);
+        p = skip_spaces(p, end);
+        weight_t w = 1;
+        if (h.has_e_weights) {
+            w = parse_uint(p, end);
+            p = skip_spaces(p, end);
+        }
+        add_edge(v - 1, w);
+    }
+    return p < end ? p + 1 : end;
+}
+
+template<typename Parser>
+void parse(const std::string &file,
+           Csr &g,
+           Parser &&parse_vertex) {
+    const char *p = file.data();
+    const char *end = file.data() + file.size();
+
+    MetisHeader h;
+    p = parse_metis_header(p, end, h);
+
+    u64 curr_m = 0;
+    g.neighborhoods[0] = 0;
+    for (u64 u = 0; u < h.n; ++u) {
+        p = parse_vertex(p, end, h, [&](const vertex_t v, const weight_t w) {
+            g.edges_v[curr_m] = v;
+            g.edges_w[curr_m] = w;
+            ++curr_m;
+        });
+        g.neighborhoods[u + 1] = curr_m;
+    }
+}
+
+/**
+ * Best time of reps runs in seconds.
+ */
+template<typename F>
+f64 best_time(const u64 reps,
+              F &&f) {
+    f64 best = 1e300;
+    for (u64 r = 0; r < reps; ++r) {
+        auto sp = std::chrono::steady_clock::now();
+        f();
+        auto ep = std::chrono::steady_clock::now();
+        best = std::min(best, (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep - sp).count() / 1e9);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const u64 n = argc > 1 ? std::stoull(argv[1]) : 1 << 20;
+    const u64 deg = argc > 2 ? std::stoull(argv[2]) : 16;
+    const u64 reps = argc > 3 ? std::stoull(argv[3]) : 5;
+
+    std::cout << "n=" << n << " m=" << n * deg << " reps=" << reps << "\n";
+    std::cout << std::setw(10) << "weights" << std::setw(10) << "MB"
+              << std::setw(14) << "bytewise [s]" << std::setw(16) << "vectorized [s]" << std::setw(12) << "speedup" << "\n";
+
+    bool all_same = true;
+    for (const bool weighted: {false, true}) {
+        const std::string file = generate_metis(n, deg, weighted, 0);
+
+        Csr a, b;
+        for (Csr *g: {&a, &b}) {
+            g->neighborhoods.resize(n + 1);
+            g->edges_v.resize(n * deg);
+            g->edges_w.resize(n * deg);
+        }
+
+        const f64 t_bytewise = best_time(reps, [&]() {
+            parse(file, a, [](const char *p, const char *end, const MetisHeader &h, auto &&add_edge) {
+                return parse_metis_vertex_bytewise(p, end, h, add_edge);
+            });
+        });
+        const f64 t_vectorized = best_time(reps, [&]() {
+            parse(file, b, [](const char *p, const char *end, const MetisHeader &h, auto &&add_edge) {
+                weight_t vw;
+                return parse_metis_vertex(p, end, h, vw, add_edge);
+            });
+        });
+        all_same &= a == b;
+
+        std::cout << std::setw(10) << (weighted ? "yes" : "no") << std::fixed << std::setprecision(1)
+                  << std::setw(10) << (f64) file.size() / 1e6 << std::setprecision(4)
+                  << std::setw(14) << t_bytewise << std::setw(16) << t_vectorized
+                  << std::setprecision(2) << std::setw(11) << t_bytewise / t_vectorized << "x\n";
+    }
+
+    if (!all_same) {
+        std::cout << "Parsers do not agree!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
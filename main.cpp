@@ -22,9 +22,17 @@
 #include <string>
 #include <vector>
 
+#include "src/approx_util.h"
 #include "src/definitions.h"
+#include "src/dynamic_graph.h"
 #include "src/graph.h"
+#include "src/hotspots.h"
+#include "src/load_pipeline.h"
+#include "src/out_of_core.h"
+#include "src/parallel_util.h"
 #include "src/partition_util.h"
+#include "src/reorder.h"
+#include "src/validate.h"
 
 using namespace ProMapAnalyzer;
 
@@ -43,46 +51,143 @@ int main(int argc, char *argv[]) {
     f64 epsilon = 0.03;
     std::string out_path = "out.JSON";
 
-    if (argc == 7) {
+    // optional flags
+    f64 approx_error = 0.0;
+    f64 approx_time = 0.0;
+    u64 approx_seed = 0;
+    u64 memory_limit = 0;
+    u64 n_threads = default_n_threads();
+    VertexOrder order = VertexOrder::NONE;
+    std::string cache_prefix;
+    bool validate = false;
+    std::string level_epsilon_str;
+    std::vector<std::string> update_paths;
+    std::string updates_out_path;
+    u64 n_hotspots = 0;
+
+    bool valid_args = argc >= 7;
+    if (valid_args) {
         graph_path = args[1];
         partition_path = args[2];
         hierarchy_str = args[3];
         distance_str = args[4];
         epsilon = std::stod(args[5]);
         out_path = args[6];
+
+        for (size_t i = 7; i < args.size() && valid_args; ++i) {
+            const std::string &flag = args[i];
+            if (flag == "--validate") {
+                validate = true;
+            } else if (i + 1 >= args.size()) {
+                std::cerr << "Error: missing value for '" << flag << "'.\n\n";
+                valid_args = false;
+            } else if (flag == "--approx-error") {
+                approx_error = std::stod(args[++i]);
+            } else if (flag == "--approx-time") {
+                approx_time = std::stod(args[++i]);
+            } else if (flag == "--approx-seed") {
+                approx_seed = std::stoull(args[++i]);
+            } else if (flag == "--memory-limit") {
+                memory_limit = parse_bytes(args[++i]);
+                if (memory_limit == 0) {
+                    std::cerr << "Error: invalid memory limit '" << args[i] << "'.\n\n";
+                    valid_args = false;
+                }
+            } else if (flag == "--threads") {
+                n_threads = std::max<u64>(1, std::stoull(args[++i]));
+            } else if (flag == "--reorder") {
+                if (!parse_vertex_order(args[++i], order)) {
+                    std::cerr << "Error: unknown vertex order '" << args[i] << "'.\n\n";
+                    valid_args = false;
+                }
+            } else if (flag == "--save-reordered") {
+                cache_prefix = args[++i];
+            } else if (flag == "--level-epsilon") {
+                level_epsilon_str = args[++i];
+            } else if (flag == "--updates") {
+                update_paths.push_back(args[++i]);
+            } else if (flag == "--updates-out") {
+                updates_out_path = args[++i];
+            } else if (flag == "--hotspots") {
+                n_hotspots = std::stoull(args[++i]);
+            } else {
+                std::cerr << "Error: unknown option '" << flag << "'.\n\n";
+                valid_args = false;
+            }
+        }
     } else {
+        std::cerr << "Error: invalid number of arguments (" << argc - 1 << " given).\n\n";
+    }
+
+    if (!valid_args) {
         std::cerr
-                << "Error: invalid number of arguments (" << argc - 1 << " given).\n\n"
                 << "Usage:\n"
                 << "  " << args[0]
-                << " <graph> <partition> <hierarchy> <distances> <epsilon> <output>\n\n"
+                << " <graph> <partition> <hierarchy> <distances> <epsilon> <output> [options]\n\n"
                 << "Arguments:\n"
-                << "  <graph>       Path to input graph file (METIS format)\n"
+                << "  <graph>       Path to input graph file (METIS, ParHIP binary, Matrix Market or edge list)\n"
                 << "  <partition>   Path to partition file\n"
                 << "  <hierarchy>   Colon-separated hierarchy levels (e.g. 4:8:6)\n"
                 << "  <distances>   Colon-separated distance thresholds (e.g. 1:10:100)\n"
                 << "  <epsilon>     Approximation parameter (e.g. 0.03)\n"
                 << "  <output>      Output JSON file\n\n"
+                << "Options:\n"
+                << "  --approx-error <e>  Estimate cut metrics by edge sampling until the 95% confidence\n"
+                << "                      interval is within +-e (relative, e.g. 0.005)\n"
+                << "  --approx-time <s>   Estimate cut metrics by edge sampling for at most s seconds\n"
+                << "  --approx-seed <x>   Seed of the sampler (default 0)\n"
+                << "  --memory-limit <b>  Stream the graph in segments, keeping peak memory below b bytes\n"
+                << "                      (suffixes K, M, G, T allowed, e.g. 4G)\n"
+                << "  --threads <t>       Number of threads (default: all hardware threads)\n"
+                << "  --reorder <o>       Renumber the vertices before evaluation for a cache-friendly layout,\n"
+                << "                      o is one of block, rcm (or bfs), degree\n"
+                << "  --save-reordered <p>\n"
+                << "                      Store the (reordered) graph as p.bin (ParHIP) or p.graph (METIS,\n"
+                << "                      if weighted) and the partition as p.part\n"
+                << "  --level-epsilon <e> Colon-separated epsilon per hierarchy level for the level balance\n"
+                << "                      (e.g. 0.03:0.02:0.01, default: epsilon on every level)\n"
+                << "  --updates <f>       Apply the edge updates in f after evaluating the graph and report\n"
+                << "                      the changed cut metrics, can be given repeatedly (one step per file)\n"
+                << "  --updates-out <f>   JSON lines output of the update steps (default: <output>l)\n"
+                << "  --hotspots <N>      Report the N vertices and the N cut edges with the highest\n"
+                << "                      communication cost\n"
+                << "  --validate          Check the graph for out-of-range neighbors, self-loops, duplicate\n"
+                << "                      edges and missing or differently weighted reverse edges\n\n"
                 << "Example:\n"
                 << "  " << args[0]
                 << " graph.graph part.txt 4:8:6 1:10:100 0.03 out.json\n";
 
         std::exit(EXIT_FAILURE);
     }
+    const bool approximate = approx_error > 0.0 || approx_time > 0.0;
 
-    Graph g(graph_path);
-    std::vector<u64> partition = read_partition(partition_path, g.n);
-    std::vector<u64> hierarchy = convert<u64>(split(hierarchy_str, ':'));
-    std::vector<u64> distance = convert<u64>(split(distance_str, ':'));
-    u64 k = prod<u64>(hierarchy);
+    if (approximate && memory_limit > 0) {
+        std::cerr << "Error: approximate evaluation and --memory-limit can not be combined.\n";
+        std::exit(EXIT_FAILURE);
+    }
 
-    auto ep_io = std::chrono::system_clock::now();
+    if ((order != VertexOrder::NONE || !cache_prefix.empty() || validate) && memory_limit > 0) {
+        std::cerr << "Error: --reorder, --save-reordered and --validate can not be combined with --memory-limit.\n";
+        std::exit(EXIT_FAILURE);
+    }
 
-    if (g.n != partition.size()) {
-        std::cout << "Graph (n=" << g.n << ") and partition (n=" << partition.size() << ") do not have same number of vertices!" << std::endl;
-        exit(EXIT_FAILURE);
+    if (!update_paths.empty() && (approximate || memory_limit > 0 || order != VertexOrder::NONE)) {
+        std::cerr << "Error: --updates can not be combined with approximate evaluation, --memory-limit or --reorder.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (n_hotspots > 0 && approximate) {
+        std::cerr << "Error: --hotspots can not be combined with approximate evaluation.\n";
+        std::exit(EXIT_FAILURE);
     }
 
+    if (updates_out_path.empty()) {
+        updates_out_path = out_path + "l";
+    }
+
+    std::vector<u64> hierarchy = convert<u64>(split(hierarchy_str, ':'));
+    std::vector<u64> distance = convert<u64>(split(distance_str, ':'));
+    u64 k = prod<u64>(hierarchy);
+
     if (hierarchy.empty()) {
         std::cout << "Entered hierarchy ('" << hierarchy_str << "') is not a valid hierarchy!" << std::endl;
         exit(EXIT_FAILURE);
@@ -93,46 +198,240 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if (max(partition) >= k) {
-        std::cout << "Partition contains id " << max(partition) << " which is greater than k=" << k << std::endl;
-        exit(EXIT_FAILURE);
+    std::vector<f64> level_epsilon(hierarchy.size(), epsilon);
+    if (!level_epsilon_str.empty()) {
+        level_epsilon = convert<f64>(split(level_epsilon_str, ':'));
+        if (level_epsilon.size() != hierarchy.size()) {
+            std::cout << "Level epsilon size (" << level_epsilon.size() << ") is not equal to Hierarchy size (" << hierarchy.size() << ")!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
     }
 
+    vertex_t n = 0, m = 0;
+    weight_t graph_weight = 0, edge_weight = 0;
+    std::vector<f64> partition_balance;
+    std::vector<u64> partition_weights;
+
+    u64 edge_cut = 0, weighted_edge_cut = 0, comm_cost = 0;
+    std::vector<u64> edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer;
+    ApproxStats approx_stats;
+
+    auto ep_io = std::chrono::system_clock::now();
     auto sp_process = std::chrono::system_clock::now();
+    f64 duration_reorder = 0.0;
+    f64 duration_validate = 0.0;
+    f64 duration_updates = 0.0;
+    ValidationReport validation;
+    Hotspots hotspots(n_hotspots);
+    std::vector<vertex_t> old_of;
 
-    std::vector<f64> partition_balance = determine_partition_balance(g, partition, k);
-    std::vector<u64> partition_weights = determine_partition_weights(g, partition, k);
+    if (memory_limit > 0) {
+        // graph is streamed, I/O and processing overlap
+        OutOfCoreResult res = evaluate_out_of_core(graph_path, partition_path, hierarchy, distance, k, memory_limit, n_threads, n_hotspots > 0 ? &hotspots : nullptr);
 
-    u64 edge_cut, weighted_edge_cut, comm_cost;
-    std::vector<u64> edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer;
-    determine_all_stats(g, partition, hierarchy, distance, k, edge_cut, weighted_edge_cut, comm_cost, edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer);
+        n = res.n;
+        m = res.m;
+        graph_weight = res.graph_weight;
+        edge_weight = res.edge_weight;
+        partition_weights = std::move(res.partition_weights);
+        partition_balance = determine_partition_balance(partition_weights, graph_weight);
+
+        edge_cut = res.stats.edge_cut;
+        weighted_edge_cut = res.stats.weighted_edge_cut;
+        comm_cost = res.stats.comm_cost;
+        edge_cut_layer = std::move(res.stats.edge_cut_layer);
+        weighted_edge_cut_layer = std::move(res.stats.weighted_edge_cut_layer);
+        comm_cost_layer = std::move(res.stats.comm_cost_layer);
+    } else {
+        // the partition is read and checked while the graph is parsed, the
+        // block weights are accumulated as the vertex weights arrive
+        PartitionLoader loader(partition_path, k);
+        Graph g(graph_path, n_threads, &loader);
+        partition_weights = loader.finish(g);
+        std::vector<u64> &partition = loader.get_partition();
+
+        ep_io = std::chrono::system_clock::now();
+
+        if (validate) {
+            auto sp_validate = std::chrono::system_clock::now();
+            validation = validate_graph(g, n_threads);
+            auto ep_validate = std::chrono::system_clock::now();
+            duration_validate = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_validate - sp_validate).count() / 1e9;
+
+            print_validation_report(validation);
+            if (validation.out_of_range.count > 0) {
+                std::cout << "Graph contains neighbor ids that are not less than n=" << g.n << ", can not evaluate!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        if (order != VertexOrder::NONE || !cache_prefix.empty()) {
+            auto sp_reorder = std::chrono::system_clock::now();
+            if (order != VertexOrder::NONE) {
+                old_of = determine_order(g, partition, order, n_threads);
+                reorder(g, partition, old_of, n_threads);
+                // hotspots are ranked and reported by the ids of the input graph
+                hotspots.old_of = old_of.data();
+            }
+            if (!cache_prefix.empty()) {
+                write_graph_cache(g, partition, cache_prefix);
+            }
+            auto ep_reorder = std::chrono::system_clock::now();
+            duration_reorder = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_reorder - sp_reorder).count() / 1e9;
+        }
+
+        sp_process = std::chrono::system_clock::now();
+
+        n = g.n;
+        m = g.m;
+        graph_weight = g.vertex_weights;
+        edge_weight = g.total_edge_weight();
+        partition_balance = determine_partition_balance(partition_weights, graph_weight);
+
+        if (approximate) {
+            approx_stats = determine_approx_stats(g, partition, hierarchy, distance, approx_error, approx_time, approx_seed, n_threads);
+        } else {
+            determine_all_stats(g, partition, hierarchy, distance, edge_cut, weighted_edge_cut, comm_cost, edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer, n_threads, n_hotspots > 0 ? &hotspots : nullptr);
+        }
+
+        if (!update_paths.empty()) {
+            Stats base_stats(hierarchy.size());
+            base_stats.edge_cut = edge_cut;
+            base_stats.weighted_edge_cut = weighted_edge_cut;
+            base_stats.comm_cost = comm_cost;
+            base_stats.edge_cut_layer = edge_cut_layer;
+            base_stats.weighted_edge_cut_layer = weighted_edge_cut_layer;
+            base_stats.comm_cost_layer = comm_cost_layer;
+
+            // every step reports its own time
+            auto sp_updates = std::chrono::system_clock::now();
+            evaluate_updates(g, partition, hierarchy, distance, base_stats, update_paths, updates_out_path);
+            auto ep_updates = std::chrono::system_clock::now();
+            duration_updates = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_updates - sp_updates).count() / 1e9;
+        }
+    }
+
+    std::vector<HotVertex> hot_vertices = hotspots.vertices.sorted();
+    std::vector<HotEdge> hot_edges = hotspots.edges.sorted();
+
+    std::vector<LevelBalance> level_balance = determine_level_balance(partition_weights, graph_weight, hierarchy, level_epsilon);
 
     auto ep_process = std::chrono::system_clock::now();
     f64 duration_io = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_io - sp_io).count() / 1e9;
-    f64 duration_process = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_process - sp_process).count() / 1e9;
+    f64 duration_process = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep_process - sp_process).count() / 1e9 - duration_updates;
 
     std::stringstream ss;
     ss << "{\n";
 
-    ss << "\t\"n\": " << g.n << " ,\n";
-    ss << "\t\"m\": " << g.m / 2 << " ,\n";
-    ss << "\t\"graph_weight\": " << g.vertex_weights << " ,\n";
-    ss << "\t\"edge_weight\": " << sum<weight_t>(g.edges_w) << " ,\n";
-    ss << "\t\"edge_cut\": " << edge_cut << " ,\n";
-    ss << "\t\"edge_cut_per_layer\": " << vectorToString(edge_cut_layer) << " ,\n";
-    ss << "\t\"weighted_edge_cut\": " << weighted_edge_cut << " ,\n";
-    ss << "\t\"weighted_edge_cut_per_layer\": " << vectorToString(weighted_edge_cut_layer) << " ,\n";
-    ss << "\t\"comm_cost\": " << comm_cost << " ,\n";
-    ss << "\t\"comm_cost_per_layer\": " << vectorToString(comm_cost_layer) << " ,\n";
+    ss << "\t\"n\": " << n << " ,\n";
+    ss << "\t\"m\": " << m / 2 << " ,\n";
+    ss << "\t\"graph_weight\": " << graph_weight << " ,\n";
+    ss << "\t\"edge_weight\": " << edge_weight << " ,\n";
+    if (approximate) {
+        ss << "\t\"approximate\": " << approximate << " ,\n";
+        ss << "\t\"samples\": " << approx_stats.samples << " ,\n";
+        ss << "\t\"converged\": " << approx_stats.converged << " ,\n";
+        ss << "\t\"exact\": " << approx_stats.exact << " ,\n";
+        ss << "\t\"confidence\": " << APPROX_CONFIDENCE << " ,\n";
+        ss << "\t\"edge_cut\": " << estimateToString(approx_stats.edge_cut) << " ,\n";
+        ss << "\t\"edge_cut_ci\": " << intervalToString(approx_stats.edge_cut) << " ,\n";
+        ss << "\t\"edge_cut_per_layer\": " << estimatesToString(approx_stats.edge_cut_layer) << " ,\n";
+        ss << "\t\"edge_cut_per_layer_ci\": " << intervalsToString(approx_stats.edge_cut_layer) << " ,\n";
+        ss << "\t\"weighted_edge_cut\": " << estimateToString(approx_stats.weighted_edge_cut) << " ,\n";
+        ss << "\t\"weighted_edge_cut_ci\": " << intervalToString(approx_stats.weighted_edge_cut) << " ,\n";
+        ss << "\t\"weighted_edge_cut_per_layer\": " << estimatesToString(approx_stats.weighted_edge_cut_layer) << " ,\n";
+        ss << "\t\"weighted_edge_cut_per_layer_ci\": " << intervalsToString(approx_stats.weighted_edge_cut_layer) << " ,\n";
+        ss << "\t\"comm_cost\": " << estimateToString(approx_stats.comm_cost) << " ,\n";
+        ss << "\t\"comm_cost_ci\": " << intervalToString(approx_stats.comm_cost) << " ,\n";
+        ss << "\t\"comm_cost_per_layer\": " << estimatesToString(approx_stats.comm_cost_layer) << " ,\n";
+        ss << "\t\"comm_cost_per_layer_ci\": " << intervalsToString(approx_stats.comm_cost_layer) << " ,\n";
+    } else {
+        ss << "\t\"edge_cut\": " << edge_cut << " ,\n";
+        ss << "\t\"edge_cut_per_layer\": " << vectorToString(edge_cut_layer) << " ,\n";
+        ss << "\t\"weighted_edge_cut\": " << weighted_edge_cut << " ,\n";
+        ss << "\t\"weighted_edge_cut_per_layer\": " << vectorToString(weighted_edge_cut_layer) << " ,\n";
+        ss << "\t\"comm_cost\": " << comm_cost << " ,\n";
+        ss << "\t\"comm_cost_per_layer\": " << vectorToString(comm_cost_layer) << " ,\n";
+    }
     ss << "\t\"max_balance\": " << max(partition_balance) << " ,\n";
     ss << "\t\"avg_balance\": " << sum<double>(partition_balance) / static_cast<double>(k) << " ,\n";
     ss << "\t\"min_balance\": " << min(partition_balance) << " ,\n";
-    ss << "\t\"L_max\": " << ceil((1 + epsilon) * (static_cast<double>(g.vertex_weights) / static_cast<double>(k))) << ", \n";
+    ss << "\t\"L_max\": " << ceil((1 + epsilon) * (static_cast<double>(graph_weight) / static_cast<double>(k))) << ", \n";
     ss << "\t\"partition_balance\": " << vectorToString(partition_balance) << " ,\n";
     ss << "\t\"partition_weights\": " << vectorToString(partition_weights) << ", \n";
     ss << "\t\"is_balanced_on_epsilon\": " << (max(partition_balance) <= 1.03) << ", \n";
-    ss << "\t\"is_balanced_on_L_max\": " << (static_cast<double>(max(partition_weights)) <= ceil((1 + epsilon) * (static_cast<double>(g.vertex_weights) / static_cast<double>(k)))) << ", \n";
+    ss << "\t\"is_balanced_on_L_max\": " << (static_cast<double>(max(partition_weights)) <= ceil((1 + epsilon) * (static_cast<double>(graph_weight) / static_cast<double>(k)))) << ", \n";
+    std::vector<u64> level_n_groups, level_n_overloaded, level_is_balanced;
+    std::vector<f64> level_max_balance, level_avg_balance, level_min_balance, level_L_max;
+    std::vector<std::string> level_overloaded;
+    for (const LevelBalance &lb: level_balance) {
+        level_n_groups.push_back(lb.n_groups);
+        level_max_balance.push_back(lb.max_balance);
+        level_avg_balance.push_back(lb.avg_balance);
+        level_min_balance.push_back(lb.min_balance);
+        level_L_max.push_back(lb.L_max);
+        level_is_balanced.push_back(lb.n_overloaded == 0);
+        level_n_overloaded.push_back(lb.n_overloaded);
+        level_overloaded.push_back(vectorToString(lb.overloaded));
+    }
+    ss << "\t\"level_n_groups\": " << vectorToString(level_n_groups) << ", \n";
+    ss << "\t\"level_max_balance\": " << vectorToString(level_max_balance) << ", \n";
+    ss << "\t\"level_avg_balance\": " << vectorToString(level_avg_balance) << ", \n";
+    ss << "\t\"level_min_balance\": " << vectorToString(level_min_balance) << ", \n";
+    ss << "\t\"level_epsilon\": " << vectorToString(level_epsilon) << ", \n";
+    ss << "\t\"level_L_max\": " << vectorToString(level_L_max) << ", \n";
+    ss << "\t\"level_is_balanced_on_L_max\": " << vectorToString(level_is_balanced) << ", \n";
+    ss << "\t\"level_n_overloaded\": " << vectorToString(level_n_overloaded) << ", \n";
+    ss << "\t\"level_overloaded_groups\": " << vectorToString(level_overloaded) << ", \n";
+    if (validate) {
+        ss << "\t\"valid_graph\": " << validation.valid() << ", \n";
+        ss << "\t\"out_of_range_neighbors\": " << validation.out_of_range.count << ", \n";
+        ss << "\t\"self_loops\": " << validation.self_loops.count << ", \n";
+        ss << "\t\"self_loops_first_vertices\": " << vectorToString(validation.self_loops.first_vertices) << ", \n";
+        ss << "\t\"duplicate_edges\": " << validation.duplicates.count << ", \n";
+        ss << "\t\"duplicate_edges_first_vertices\": " << vectorToString(validation.duplicates.first_vertices) << ", \n";
+        ss << "\t\"asymmetric_edges\": " << validation.asymmetric.count << ", \n";
+        ss << "\t\"asymmetric_edges_first_vertices\": " << vectorToString(validation.asymmetric.first_vertices) << ", \n";
+        ss << "\t\"reverse_weight_mismatches\": " << validation.weight_mismatches.count << ", \n";
+        ss << "\t\"reverse_weight_mismatches_first_vertices\": " << vectorToString(validation.weight_mismatches.first_vertices) << ", \n";
+    }
+    if (n_hotspots > 0) {
+        std::vector<u64> hot_v, hot_v_block, hot_v_comm_cost, hot_v_edge_cut;
+        for (const HotVertex &x: hot_vertices) {
+            hot_v.push_back(x.u);
+            hot_v_block.push_back(x.block);
+            hot_v_comm_cost.push_back(x.comm_cost);
+            hot_v_edge_cut.push_back(x.edge_cut);
+        }
+        std::vector<u64> hot_e_u, hot_e_v, hot_e_u_block, hot_e_v_block, hot_e_layer, hot_e_weight, hot_e_comm_cost;
+        for (const HotEdge &e: hot_edges) {
+            hot_e_u.push_back(e.u);
+            hot_e_v.push_back(e.v);
+            hot_e_u_block.push_back(e.u_block);
+            hot_e_v_block.push_back(e.v_block);
+            hot_e_layer.push_back(e.layer);
+            hot_e_weight.push_back(e.weight);
+            hot_e_comm_cost.push_back(e.comm_cost);
+        }
+        ss << "\t\"hotspot_vertices\": " << vectorToString(hot_v) << ", \n";
+        ss << "\t\"hotspot_vertex_blocks\": " << vectorToString(hot_v_block) << ", \n";
+        ss << "\t\"hotspot_vertex_comm_cost\": " << vectorToString(hot_v_comm_cost) << ", \n";
+        ss << "\t\"hotspot_vertex_edge_cut\": " << vectorToString(hot_v_edge_cut) << ", \n";
+        ss << "\t\"hotspot_edges_u\": " << vectorToString(hot_e_u) << ", \n";
+        ss << "\t\"hotspot_edges_v\": " << vectorToString(hot_e_v) << ", \n";
+        ss << "\t\"hotspot_edge_u_blocks\": " << vectorToString(hot_e_u_block) << ", \n";
+        ss << "\t\"hotspot_edge_v_blocks\": " << vectorToString(hot_e_v_block) << ", \n";
+        ss << "\t\"hotspot_edge_layers\": " << vectorToString(hot_e_layer) << ", \n";
+        ss << "\t\"hotspot_edge_weights\": " << vectorToString(hot_e_weight) << ", \n";
+        ss << "\t\"hotspot_edge_comm_cost\": " << vectorToString(hot_e_comm_cost) << ", \n";
+    }
     ss << "\t\"io_in\": " << duration_io << ", \n";
+    if (order != VertexOrder::NONE || !cache_prefix.empty()) {
+        ss << "\t\"reordered_in\": " << duration_reorder << ", \n";
+    }
+    if (validate) {
+        ss << "\t\"validated_in\": " << duration_validate << ", \n";
+    }
     ss << "\t\"processed_in\": " << duration_process << "\n";
 
     ss << "}";
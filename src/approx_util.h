@@ -0,0 +1,317 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_APPROX_UTIL_H
+#define PROCESSMAPPINGANALYZER_APPROX_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "partition_util.h"
+#include "topology.h"
+
+namespace ProMapAnalyzer {
+    // z-value of the two-sided 95% confidence interval
+    constexpr f64 APPROX_Z = 1.959963984540054;
+    constexpr f64 APPROX_CONFIDENCE = 0.95;
+
+    // number of samples drawn between two checks of the stopping rule
+    constexpr u64 APPROX_BATCH = 1 << 14;
+
+    // cut samples every metric and layer needs before its interval counts, a
+    // layer without any would have an interval of width zero
+    constexpr u64 APPROX_MIN_HITS = 10;
+
+    // a sample (binary search over the offsets, random accesses) costs about
+    // as much as this many edges of the exact sweep on one thread
+    constexpr u64 APPROX_SAMPLE_COST = 16;
+
+    struct Estimate {
+        f64 value = 0.0;
+        f64 half_width = 0.0;
+
+        f64 lo() const { return value - half_width; }
+
+        f64 hi() const { return value + half_width; }
+    };
+
+    struct ApproxStats {
+        u64 samples = 0;
+        bool converged = false;
+        bool exact = false; // sampling would have cost more than the exact sweep
+
+        Estimate edge_cut;
+        Estimate weighted_edge_cut;
+        Estimate comm_cost;
+
+        std::vector<Estimate> edge_cut_layer;
+        std::vector<Estimate> weighted_edge_cut_layer;
+        std::vector<Estimate> comm_cost_layer;
+    };
+
+    /**
+     * Running sum and sum of squares of one per-sample quantity.
+     */
+    struct Moments {
+        f64 s1 = 0.0;
+        f64 s2 = 0.0;
+
+        void add(const f64 x) {
+            s1 += x;
+            s2 += x * x;
+        }
+
+        /**
+         * Scales the sample mean to the population of m directed edges.
+         */
+        Estimate estimate(const u64 samples, const f64 m, const f64 scale) const {
+            Estimate e;
+            if (samples == 0) { return e; }
+
+            const f64 s = static_cast<f64>(samples);
+            const f64 mean = s1 / s;
+            const f64 var = samples > 1 ? std::max(0.0, (s2 - s * mean * mean) / (s - 1)) : 0.0;
+
+            e.value = m * mean * scale;
+            e.half_width = APPROX_Z * m * std::sqrt(var / s) * scale;
+            return e;
+        }
+    };
+
+    inline std::string estimateToString(const Estimate &e) {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1) << e.value;
+        return oss.str();
+    }
+
+    inline std::string intervalToString(const Estimate &e) {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1) << "[" << e.lo() << ", " << e.hi() << "]";
+        return oss.str();
+    }
+
+    inline std::string estimatesToString(const std::vector<Estimate> &vec) {
+        std::ostringstream oss;
+        oss << "[";
+        for (size_t i = 0; i < vec.size(); ++i) {
+            oss << estimateToString(vec[i]);
+            if (i != vec.size() - 1) {
+                oss << ", ";
+            }
+        }
+        oss << "]";
+        return oss.str();
+    }
+
+    inline std::string intervalsToString(const std::vector<Estimate> &vec) {
+        std::ostringstream oss;
+        oss << "[";
+        for (size_t i = 0; i < vec.size(); ++i) {
+            oss << intervalToString(vec[i]);
+            if (i != vec.size() - 1) {
+                oss << ", ";
+            }
+        }
+        oss << "]";
+        return oss.str();
+    }
+
+    /**
+     * Draws the samples of determine_approx_stats on the given topology.
+     */
+    template<typename Topology>
+    inline ApproxStats sample_stats(const Graph &g,
+                                    const std::vector<u64> &partition,
+                                    const Topology &topology,
+                                    const f64 target_error,
+                                    const f64 time_budget,
+                                    const u64 seed,
+                                    const u64 n_threads) {
+        const size_t s = topology.depth();
+        const f64 m = static_cast<f64>(g.m);
+
+        // the sampler runs on one thread, the exact sweep on n_threads
+        const u64 sample_cost = APPROX_SAMPLE_COST * std::max<u64>(n_threads, 1);
+
+        ApproxStats stats;
+        stats.edge_cut_layer.resize(s);
+        stats.weighted_edge_cut_layer.resize(s);
+        stats.comm_cost_layer.resize(s);
+        if (g.m == 0) {
+            stats.converged = true;
+            return stats;
+        }
+
+        Moments ec, wec, cc;
+        std::vector<Moments> ec_layer(s), wec_layer(s), cc_layer(s);
+
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<u64> dist(0, g.m - 1);
+
+        auto sp = std::chrono::steady_clock::now();
+        u64 samples = 0;
+        while (true) {
+            if ((samples + APPROX_BATCH) * sample_cost > g.m) {
+                stats.exact = true;
+                break;
+            }
+
+            for (u64 i = 0; i < APPROX_BATCH; ++i) {
+                const u64 idx = dist(rng);
+                const u64 u = (u64) (std::upper_bound(g.neighborhoods.begin(), g.neighborhoods.end(), idx) - g.neighborhoods.begin()) - 1;
+                const u64 v = g.edges_v[idx];
+                const u64 weight = g.edge_weight(idx);
+
+                const u64 u_id = partition[u];
+                const u64 v_id = partition[v];
+
+                u64 d = 0, u_v_distance = 0;
+                const bool cut = u_id != v_id;
+                if (cut) {
+                    d = topology.layer(u_id, v_id);
+                    u_v_distance = topology.distance[d];
+                }
+
+                const f64 x_ec = cut ? 1.0 : 0.0;
+                const f64 x_wec = cut ? static_cast<f64>(weight) : 0.0;
+                const f64 x_cc = cut ? static_cast<f64>(weight * u_v_distance) : 0.0;
+
+                ec.add(x_ec);
+                wec.add(x_wec);
+                cc.add(x_cc);
+
+                // a sample contributes zero to every layer except the cut one
+                for (size_t l = 0; l < s; ++l) {
+                    const bool in_layer = cut && l == d;
+                    ec_layer[l].add(in_layer ? x_ec : 0.0);
+                    wec_layer[l].add(in_layer ? x_wec : 0.0);
+                    cc_layer[l].add(in_layer ? x_cc : 0.0);
+                }
+            }
+            samples += APPROX_BATCH;
+
+            // edge cuts count each undirected edge twice, comm cost does not
+            stats.edge_cut = ec.estimate(samples, m, 0.5);
+            stats.weighted_edge_cut = wec.estimate(samples, m, 0.5);
+            stats.comm_cost = cc.estimate(samples, m, 1.0);
+            for (size_t l = 0; l < s; ++l) {
+                stats.edge_cut_layer[l] = ec_layer[l].estimate(samples, m, 0.5);
+                stats.weighted_edge_cut_layer[l] = wec_layer[l].estimate(samples, m, 0.5);
+                stats.comm_cost_layer[l] = cc_layer[l].estimate(samples, m, 1.0);
+            }
+
+            if (target_error > 0.0) {
+                // also projects the number of samples the widest interval needs
+                bool within = true;
+                f64 needed = (f64) samples;
+                auto check = [&](const Estimate &e, const f64 hits) {
+                    if (hits < (f64) APPROX_MIN_HITS) {
+                        // without hits, the rule of three bounds the hit rate by 3 / samples
+                        within = false;
+                        needed = std::max(needed, (f64) samples * (f64) APPROX_MIN_HITS / std::max(hits, 3.0));
+                    } else if (e.half_width > target_error * e.value) {
+                        within = false;
+                        const f64 r = e.half_width / (target_error * e.value);
+                        needed = std::max(needed, (f64) samples * r * r);
+                    }
+                };
+                for (const Estimate *e: {&stats.edge_cut, &stats.weighted_edge_cut, &stats.comm_cost}) {
+                    check(*e, ec.s1);
+                }
+                for (size_t l = 0; l < s; ++l) {
+                    for (const Estimate *e: {&stats.edge_cut_layer[l], &stats.weighted_edge_cut_layer[l], &stats.comm_cost_layer[l]}) {
+                        check(*e, ec_layer[l].s1);
+                    }
+                }
+                if (within) {
+                    stats.converged = true;
+                    break;
+                }
+                if (needed * (f64) sample_cost > m) {
+                    stats.exact = true;
+                    break;
+                }
+            }
+
+            if (time_budget > 0.0) {
+                auto ep = std::chrono::steady_clock::now();
+                const f64 elapsed = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep - sp).count() / 1e9;
+                if (elapsed >= time_budget) {
+                    break;
+                }
+            }
+        }
+
+        stats.samples = samples;
+        return stats;
+    }
+
+    /**
+     * Estimates edge cut, weighted edge cut and communication cost (also per
+     * layer) by sampling directed edges uniformly at random from the CSR.
+     * Each sample is an unbiased estimator of the per-edge contribution, so
+     * m times the sample mean is an unbiased estimator of the total.
+     *
+     * Sampling stops once the 95% confidence interval of all three metrics,
+     * in total and on every layer, is within +-target_error (relative) and
+     * is based on at least APPROX_MIN_HITS cut samples, or once time_budget
+     * seconds are used up. A value of 0 disables the respective criterion.
+     *
+     * Once the samples drawn or, with a target error, the samples projected
+     * to meet it would cost more than the exact sweep, the stats are
+     * determined exactly instead (exact, converged, intervals of width 0).
+     */
+    inline ApproxStats determine_approx_stats(const Graph &g,
+                                              const std::vector<u64> &partition,
+                                              const std::vector<u64> &hierarchy,
+                                              const std::vector<u64> &distance,
+                                              const f64 target_error,
+                                              const f64 time_budget,
+                                              const u64 seed,
+                                              const u64 n_threads = 1) {
+        ApproxStats stats = with_topology(hierarchy, distance, [&](const auto &topology) {
+            return sample_stats(g, partition, topology, target_error, time_budget, seed, n_threads);
+        });
+        if (!stats.exact) { return stats; }
+
+        u64 edge_cut, weighted_edge_cut, comm_cost;
+        std::vector<u64> edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer;
+        determine_all_stats(g, partition, hierarchy, distance, edge_cut, weighted_edge_cut, comm_cost, edge_cut_layer, weighted_edge_cut_layer, comm_cost_layer, n_threads);
+
+        auto exact = [](const u64 x) { return Estimate{static_cast<f64>(x), 0.0}; };
+        stats.converged = true;
+        stats.edge_cut = exact(edge_cut);
+        stats.weighted_edge_cut = exact(weighted_edge_cut);
+        stats.comm_cost = exact(comm_cost);
+        for (size_t l = 0; l < hierarchy.size(); ++l) {
+            stats.edge_cut_layer[l] = exact(edge_cut_layer[l]);
+            stats.weighted_edge_cut_layer[l] = exact(weighted_edge_cut_layer[l]);
+            stats.comm_cost_layer[l] = exact(comm_cost_layer[l]);
+        }
+        return stats;
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_APPROX_UTIL_H
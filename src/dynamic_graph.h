@@ -0,0 +1,423 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_DYNAMIC_GRAPH_H
+#define PROCESSMAPPINGANALYZER_DYNAMIC_GRAPH_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "partition_util.h"
+#include "tokenizer.h"
+#include "topology.h"
+#include "util.h"
+
+namespace ProMapAnalyzer {
+    /**
+     * Adjacency that supports inserting, deleting and reweighting edges. Like
+     * the CSR every vertex owns a contiguous range of the edge arrays, but
+     * with some free capacity behind its edges. A vertex whose range is full
+     * moves its edges to the end of the arrays with twice the capacity. The
+     * arrays are compacted once more than half of them is unused. Vertices of
+     * degree at least HUB_DEGREE additionally map each target to its offset
+     * in the range, so their edges are found without a scan.
+     */
+    class DynamicGraph {
+    public:
+        vertex_t n = 0;
+        u64 m = 0; // directed edges
+        weight_t edge_weight = 0; // sum over the directed edges
+
+        explicit DynamicGraph(const Graph &g) : n(g.n), m(g.m), edge_weight(g.total_edge_weight()),
+                                                begin(g.n), degree(g.n), capacity(g.n), index(g.n) {
+            u64 total = 0;
+            for (vertex_t u = 0; u < n; ++u) {
+                degree[u] = g.neighborhoods[u + 1] - g.neighborhoods[u];
+                capacity[u] = slack_capacity(degree[u]);
+                begin[u] = total;
+                total += capacity[u];
+            }
+
+            edges_v.resize(total);
+            edges_w.resize(total);
+            for (vertex_t u = 0; u < n; ++u) {
+                std::copy(g.edges_v.begin() + g.neighborhoods[u], g.edges_v.begin() + g.neighborhoods[u + 1], edges_v.begin() + (s64) begin[u]);
+                for (u64 idx = g.neighborhoods[u]; idx < g.neighborhoods[u + 1]; ++idx) {
+                    edges_w[begin[u] + idx - g.neighborhoods[u]] = g.edge_weight(idx);
+                }
+                if (degree[u] >= HUB_DEGREE) { build_index(u); }
+            }
+            used = total;
+        }
+
+        /**
+         * Weight of the edge (u, v), if it exists.
+         */
+        bool find(const vertex_t u,
+                  const vertex_t v,
+                  weight_t &w) const {
+            const u64 idx = position(u, v);
+            if (idx == NOT_FOUND) { return false; }
+            w = edges_w[idx];
+            return true;
+        }
+
+        /**
+         * Inserts the edge {u, v}, which must not exist yet.
+         */
+        void insert(const vertex_t u,
+                    const vertex_t v,
+                    const weight_t w) {
+            insert_half(u, v, w);
+            insert_half(v, u, w);
+            m += 2;
+            edge_weight += 2 * w;
+        }
+
+        /**
+         * Removes the edge {u, v}, both (u, v) and (v, u) must exist.
+         */
+        void erase(const vertex_t u,
+                   const vertex_t v) {
+            const weight_t w = edges_w[position(u, v)];
+            erase_half(u, v);
+            erase_half(v, u);
+            m -= 2;
+            edge_weight -= 2 * w;
+        }
+
+        /**
+         * Sets the weight of the edge {u, v}, both (u, v) and (v, u) must
+         * exist.
+         */
+        void set_weight(const vertex_t u,
+                        const vertex_t v,
+                        const weight_t w) {
+            const u64 idx_u = position(u, v);
+            const u64 idx_v = position(v, u);
+            edge_weight += 2 * (w - edges_w[idx_u]);
+            edges_w[idx_u] = w;
+            edges_w[idx_v] = w;
+        }
+
+    private:
+        static constexpr u64 NOT_FOUND = ~0ULL;
+        static constexpr u64 HUB_DEGREE = 64;
+
+        std::vector<u64> begin;
+        std::vector<u64> degree;
+        std::vector<u64> capacity;
+
+        // offsets of the targets in the range, only for vertices that reached
+        // HUB_DEGREE, the offsets stay valid when a range is moved
+        std::vector<std::unique_ptr<std::unordered_map<vertex_t, u64>>> index;
+
+        std::vector<vertex_t> edges_v;
+        std::vector<weight_t> edges_w;
+        u64 used = 0; // end of the last range
+
+        static u64 slack_capacity(const u64 d) {
+            return d + d / 4 + 2;
+        }
+
+        u64 position(const vertex_t u,
+                     const vertex_t v) const {
+            if (index[u] != nullptr) {
+                const auto it = index[u]->find(v);
+                return it == index[u]->end() ? NOT_FOUND : begin[u] + it->second;
+            }
+            for (u64 idx = begin[u]; idx < begin[u] + degree[u]; ++idx) {
+                if (edges_v[idx] == v) { return idx; }
+            }
+            return NOT_FOUND;
+        }
+
+        void insert_half(const vertex_t u,
+                         const vertex_t v,
+                         const weight_t w) {
+            if (degree[u] == capacity[u]) { grow(u); }
+
+            edges_v[begin[u] + degree[u]] = v;
+            edges_w[begin[u] + degree[u]] = w;
+            if (index[u] != nullptr) { index[u]->emplace(v, degree[u]); }
+            ++degree[u];
+            if (degree[u] == HUB_DEGREE && index[u] == nullptr) { build_index(u); }
+        }
+
+        void erase_half(const vertex_t u,
+                        const vertex_t v) {
+            // the last edge of u takes the place of the removed one
+            const u64 idx = position(u, v);
+            const u64 last = begin[u] + degree[u] - 1;
+            edges_v[idx] = edges_v[last];
+            edges_w[idx] = edges_w[last];
+            if (index[u] != nullptr) {
+                index[u]->erase(v);
+                if (idx != last) { (*index[u])[edges_v[idx]] = idx - begin[u]; }
+            }
+            --degree[u];
+        }
+
+        /**
+         * Indexes the edges of u. A vertex with duplicate edges (only possible
+         * in the base graph) is left to the scan, which finds every copy.
+         */
+        void build_index(const vertex_t u) {
+            auto map = std::make_unique<std::unordered_map<vertex_t, u64>>();
+            map->reserve(2 * degree[u]);
+            for (u64 i = 0; i < degree[u]; ++i) {
+                if (!map->emplace(edges_v[begin[u] + i], i).second) { return; }
+            }
+            index[u] = std::move(map);
+        }
+
+        void grow(const vertex_t u) {
+            const u64 new_capacity = 2 * capacity[u];
+            if (used + new_capacity > edges_v.size()) {
+                if (2 * m < used) {
+                    compact();
+                }
+                if (used + new_capacity > edges_v.size()) {
+                    const u64 size = std::max<u64>(2 * edges_v.size(), used + new_capacity);
+                    edges_v.resize(size);
+                    edges_w.resize(size);
+                }
+            }
+
+            std::copy(edges_v.begin() + (s64) begin[u], edges_v.begin() + (s64) (begin[u] + degree[u]), edges_v.begin() + (s64) used);
+            std::copy(edges_w.begin() + (s64) begin[u], edges_w.begin() + (s64) (begin[u] + degree[u]), edges_w.begin() + (s64) used);
+            begin[u] = used;
+            capacity[u] = new_capacity;
+            used += new_capacity;
+        }
+
+        /**
+         * Packs the ranges in vertex order, each with its slack capacity.
+         */
+        void compact() {
+            std::vector<vertex_t> new_edges_v;
+            std::vector<weight_t> new_edges_w;
+            new_edges_v.reserve(edges_v.size());
+            new_edges_w.reserve(edges_w.size());
+
+            for (vertex_t u = 0; u < n; ++u) {
+                const u64 b = new_edges_v.size();
+                new_edges_v.insert(new_edges_v.end(), edges_v.begin() + (s64) begin[u], edges_v.begin() + (s64) (begin[u] + degree[u]));
+                new_edges_w.insert(new_edges_w.end(), edges_w.begin() + (s64) begin[u], edges_w.begin() + (s64) (begin[u] + degree[u]));
+                capacity[u] = slack_capacity(degree[u]);
+                new_edges_v.resize(b + capacity[u]);
+                new_edges_w.resize(b + capacity[u]);
+                begin[u] = b;
+            }
+
+            used = new_edges_v.size();
+            new_edges_v.resize(std::max<u64>(used, edges_v.size()));
+            new_edges_w.resize(std::max<u64>(used, edges_w.size()));
+            edges_v = std::move(new_edges_v);
+            edges_w = std::move(new_edges_w);
+        }
+    };
+
+    struct UpdateCounts {
+        u64 inserted = 0;
+        u64 deleted = 0;
+        u64 reweighted = 0;
+        u64 ignored = 0; // deletions and reweights of missing edges, self-loops
+    };
+
+    /**
+     * Adds (sign = 1) or removes (sign = -1) the contribution of the
+     * undirected edge {u, v} to the finalized stats: once to the cuts and,
+     * as both directions are counted, twice to the communication cost.
+     */
+    template<typename Topology>
+    inline void update_contribution(const u64 u_id,
+                                    const u64 v_id,
+                                    const weight_t w,
+                                    const s64 sign,
+                                    const Topology &topology,
+                                    Stats &stats) {
+        if (u_id == v_id) { return; }
+
+        const u64 d = topology.layer(u_id, v_id);
+        const u64 one = (u64) sign;
+        const u64 weight = (u64) (sign * w);
+        const u64 cost = 2 * weight * topology.distance[d];
+
+        stats.edge_cut += one;
+        stats.edge_cut_layer[d] += one;
+        stats.weighted_edge_cut += weight;
+        stats.weighted_edge_cut_layer[d] += weight;
+        stats.comm_cost += cost;
+        stats.comm_cost_layer[d] += cost;
+    }
+
+    /**
+     * Applies an update file to the graph and the stats. Every line is one
+     * update of an undirected edge, ids are 0-based:
+     *   + u v [w]  insert the edge (weight 1 by default), or set its weight if
+     *              it exists
+     *   - u v      delete the edge
+     *   = u v w    set the weight of the edge
+     * Lines starting with '#' or '%' and blank lines are skipped.
+     */
+    template<typename Topology>
+    inline UpdateCounts apply_updates(const std::string &path,
+                                      DynamicGraph &g,
+                                      const std::vector<u64> &partition,
+                                      const Topology &topology,
+                                      Stats &stats) {
+        if (!file_exists(path)) {
+            std::cerr << "File " << path << " does not exist!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        MMap mm = mmap_file_ro(path);
+        const char *p = mm.data;
+        const char *end = mm.data + mm.size;
+
+        UpdateCounts counts;
+        u64 line_nr = 0;
+        while (p < end) {
+            ++line_nr;
+            p = skip_spaces(p, end);
+            if (p >= end) { break; }
+            if (*p == '\n' || *p == '#' || *p == '%') {
+                p = skip_line(p, end);
+                continue;
+            }
+
+            const char *line = p;
+            const char op = *p++;
+
+            u64 ids[3] = {0, 0, 1};
+            u64 n_ids = 0;
+            while (n_ids < 3) {
+                p = skip_spaces(p, end);
+                const char *q = p;
+                const u64 x = parse_uint(p, end);
+                if (p == q) { break; }
+                ids[n_ids++] = x;
+            }
+            p = skip_spaces(p, end);
+
+            const bool valid_op = op == '+' || op == '-' || op == '=';
+            const u64 needed = op == '=' ? 3 : 2;
+            if (!valid_op || n_ids < needed || (op == '-' && n_ids > 2) || (p < end && *p != '\n') || ids[0] >= g.n || ids[1] >= g.n) {
+                std::cerr << "Invalid update '" << std::string(line, find_newline(line, end)) << "' in line " << line_nr << " of " << path << "!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            p = skip_line(p, end);
+
+            const vertex_t u = ids[0];
+            const vertex_t v = ids[1];
+            const weight_t w = (weight_t) ids[2];
+            if (u == v) {
+                ++counts.ignored;
+                continue;
+            }
+
+            // insert, erase and set_weight work on both halves, an edge
+            // stored in one direction only can not be updated
+            weight_t old_w = 0;
+            weight_t reverse_w = 0;
+            const bool exists = g.find(u, v, old_w);
+            if (exists != g.find(v, u, reverse_w)) {
+                std::cerr << "Update '" << std::string(line, find_newline(line, end)) << "' in line " << line_nr << " of " << path
+                          << " refers to an edge that is stored in one direction only (see --validate)!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            if (op == '+' && !exists) {
+                g.insert(u, v, w);
+                update_contribution(partition[u], partition[v], w, 1, topology, stats);
+                ++counts.inserted;
+            } else if (op == '-' && exists) {
+                g.erase(u, v);
+                update_contribution(partition[u], partition[v], old_w, -1, topology, stats);
+                ++counts.deleted;
+            } else if (op != '-' && exists) {
+                g.set_weight(u, v, w);
+                update_contribution(partition[u], partition[v], old_w, -1, topology, stats);
+                update_contribution(partition[u], partition[v], w, 1, topology, stats);
+                ++counts.reweighted;
+            } else {
+                ++counts.ignored;
+            }
+        }
+
+        munmap_file(mm);
+        return counts;
+    }
+
+    /**
+     * Applies the update files in order, one step each, and writes the stats
+     * after every step as one JSON object per line to out_path. Line 0 holds
+     * the stats of the base graph.
+     */
+    inline void evaluate_updates(const Graph &base,
+                                 const std::vector<u64> &partition,
+                                 const std::vector<u64> &hierarchy,
+                                 const std::vector<u64> &distance,
+                                 const Stats &base_stats,
+                                 const std::vector<std::string> &update_paths,
+                                 const std::string &out_path) {
+        std::ofstream out(out_path);
+        if (!out) {
+            std::cerr << "Could not open " << out_path << " for writing!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        DynamicGraph g(base);
+        Stats stats = base_stats;
+
+        auto write_step = [&](const u64 step, const std::string &file, const UpdateCounts &c, const f64 duration) {
+            std::stringstream ss;
+            ss << "{\"step\": " << step << ", \"updates\": " << stringToJson(file)
+               << ", \"n\": " << g.n << ", \"m\": " << g.m / 2 << ", \"edge_weight\": " << g.edge_weight
+               << ", \"inserted\": " << c.inserted << ", \"deleted\": " << c.deleted
+               << ", \"reweighted\": " << c.reweighted << ", \"ignored\": " << c.ignored
+               << ", \"edge_cut\": " << stats.edge_cut << ", \"edge_cut_per_layer\": " << vectorToString(stats.edge_cut_layer)
+               << ", \"weighted_edge_cut\": " << stats.weighted_edge_cut << ", \"weighted_edge_cut_per_layer\": " << vectorToString(stats.weighted_edge_cut_layer)
+               << ", \"comm_cost\": " << stats.comm_cost << ", \"comm_cost_per_layer\": " << vectorToString(stats.comm_cost_layer)
+               << ", \"processed_in\": " << duration << "}\n";
+            out << ss.rdbuf();
+        };
+
+        write_step(0, "", UpdateCounts(), 0.0);
+
+        with_topology(hierarchy, distance, [&](const auto &topology) {
+            for (size_t i = 0; i < update_paths.size(); ++i) {
+                auto sp = std::chrono::system_clock::now();
+                const UpdateCounts c = apply_updates(update_paths[i], g, partition, topology, stats);
+                auto ep = std::chrono::system_clock::now();
+
+                const f64 duration = (f64) std::chrono::duration_cast<std::chrono::nanoseconds>(ep - sp).count() / 1e9;
+                write_step(i + 1, update_paths[i], c, duration);
+            }
+        });
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_DYNAMIC_GRAPH_H
@@ -17,16 +17,138 @@
 #ifndef PROCESSMAPPINGANALYZER_GRAPH_H
 #define PROCESSMAPPINGANALYZER_GRAPH_H
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <regex>
 #include <string>
 #include <vector>
 
 #include "definitions.h"
+#include "graph_io.h"
+#include "parallel_util.h"
+#include "tokenizer.h"
 #include "util.h"
 
 namespace ProMapAnalyzer {
+    struct MetisHeader {
+        vertex_t n = 0;
+        vertex_t m = 0; // number of directed edges
+        bool has_v_sizes = false;
+        bool has_v_weights = false;
+        bool has_e_weights = false;
+    };
+
+    inline void invalid_character(const char *p,
+                                  const char *end) {
+        if (p < end) {
+            std::cerr << "Unexpected character '" << *p << "' (" << (int) (unsigned char) *p << ") in graph file!" << std::endl;
+        } else {
+            std::cerr << "Unexpected end of graph file!" << std::endl;
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    /**
+     * Skips all comment lines starting at p.
+     */
+    inline const char *skip_metis_comments(const char *p,
+                                           const char *end) {
+        while (p < end && *p == '%') {
+            p = skip_line(p, end);
+        }
+        return p;
+    }
+
+    /**
+     * Parses the header line "n m [fmt [ncon]]" and returns the position
+     * behind it. fmt is right-aligned, i.e. "1" and "001" both mean edge
+     * weights.
+     */
+    inline const char *parse_metis_header(const char *p,
+                                          const char *end,
+                                          MetisHeader &h) {
+        p = skip_metis_comments(p, end);
+
+        p = skip_spaces(p, end);
+        h.n = parse_uint(p, end);
+        p = skip_spaces(p, end);
+        h.m = 2 * parse_uint(p, end);
+        p = skip_spaces(p, end);
+
+        std::string fmt;
+        while (p < end && is_digit(*p)) {
+            fmt.push_back(*p);
+            ++p;
+        }
+        if (fmt.size() > 3) {
+            std::cerr << "Invalid fmt '" << fmt << "' in graph header!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        fmt.insert(0, 3 - fmt.size(), '0');
+
+        h.has_v_sizes = fmt[0] == '1';
+        h.has_v_weights = fmt[1] == '1';
+        h.has_e_weights = fmt[2] == '1';
+
+        return skip_line(p, end);
+    }
+
+    /**
+     * Parses the line of one vertex starting at p, stores its weight in vw
+     * and calls add_edge(v, w) for every neighbor (0-based). Returns the
+     * position behind the line.
+     */
+    template<typename F>
+    inline const char *parse_metis_vertex(const char *p,
+                                          const char *end,
+                                          const MetisHeader &h,
+                                          weight_t &vw,
+                                          F &&add_edge) {
+        // vertex size and weight come first, they are parsed bytewise so that
+        // the per-number callbacks below only see the neighbors
+        vw = 1;
+        for (u64 i = 0; i < (u64) h.has_v_sizes + (u64) h.has_v_weights; ++i) {
+            p = skip_spaces(p, end);
+            if (p == end || !is_digit(*p)) { break; }
+            const u64 x = parse_uint(p, end);
+            if (h.has_v_weights && (i == 1 || !h.has_v_sizes)) { vw = (weight_t) x; }
+        }
+
+        const char *invalid = nullptr;
+        bool missing_weight = false;
+        vertex_t v = 0;
+        if (h.has_e_weights) {
+            // pairs of neighbor and weight
+            p = scan_uint_line(p, end, &invalid, [&](const u64 x) {
+                if (missing_weight) { add_edge(v - 1, (weight_t) x); } else { v = x; }
+                missing_weight = !missing_weight;
+            });
+        } else {
+            p = scan_uint_line(p, end, &invalid, [&](const u64 x) { add_edge(x - 1, (weight_t) 1); });
+        }
+
+        if (invalid != nullptr) { invalid_character(invalid, end); }
+        if (missing_weight) {
+            std::cerr << "Neighbor " << v << " is missing its edge weight!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        return p;
+    }
+
+    /**
+     * Is notified while a graph is read: once n is known and the vertex
+     * weight array is allocated, and then for every vertex in order.
+     */
+    class GraphLoadObserver {
+    public:
+        virtual ~GraphLoadObserver() = default;
+
+        virtual void on_header(vertex_t n, const weight_t *v_weights) = 0;
+
+        virtual void on_vertex(vertex_t u, weight_t w) = 0;
+    };
+
     class Graph {
     public:
         vertex_t n = 0;
@@ -36,135 +158,192 @@ namespace ProMapAnalyzer {
         std::vector<weight_t> v_weights;
 
         std::vector<u64> neighborhoods;
-        std::vector<vertex_t> edges_v;
-        std::vector<weight_t> edges_w;
+        Array<vertex_t> edges_v;
+        std::vector<weight_t> edges_w; // empty if unit_edge_weights
+
+        // all edges have weight 1, no weights are stored
+        bool unit_edge_weights = false;
+
+        GraphFormat format = GraphFormat::METIS;
 
-        explicit Graph(const std::string &file_path) {
+        /**
+         * Reads a graph in METIS, ParHIP binary, Matrix Market or edge list
+         * format, see detect_graph_format. The observer, if given, receives
+         * the vertex weights while the graph is read.
+         */
+        explicit Graph(const std::string &file_path,
+                       const u64 n_threads = 1,
+                       GraphLoadObserver *t_observer = nullptr) : observer(t_observer) {
             if (!file_exists(file_path)) {
                 std::cerr << "File " << file_path << " does not exist!" << std::endl;
                 exit(EXIT_FAILURE);
             }
 
-            // mmap the whole file
-            MMap mm = mmap_file_ro(file_path);
-            char *p = mm.data;
-            const char *end = mm.data + mm.size;
-
-            // skip comment lines
-            while (*p == '%') {
-                while (*p != '\n') { ++p; }
-                ++p;
+            format = detect_graph_format(file_path);
+            switch (format) {
+                case GraphFormat::METIS:
+                    read_metis(file_path);
+                    break;
+                case GraphFormat::PARHIP:
+                    read_parhip(file_path, n_threads);
+                    break;
+                case GraphFormat::MATRIX_MARKET:
+                    read_matrix_market(file_path, n_threads);
+                    break;
+                case GraphFormat::EDGE_LIST:
+                    read_edge_list(file_path, n_threads);
+                    break;
             }
+        }
 
-            // skip whitespace
-            while (*p == ' ') { ++p; }
+        ~Graph() {
+            munmap_file(mapping);
+        }
 
-            // read number of vertices - optimized parsing
-            n = 0;
-            while (*p != ' ' && *p != '\n') {
-                n = n * 10 + (vertex_t) (*p - '0');
-                ++p;
-            }
+        Graph(const Graph &) = delete;
+
+        Graph &operator=(const Graph &) = delete;
+
+        weight_t edge_weight(const u64 idx) const {
+            return unit_edge_weights ? 1 : edges_w[idx];
+        }
+
+        /**
+         * The edge weights for the kernels, nullptr for unit weights.
+         */
+        const weight_t *edge_weights() const {
+            return unit_edge_weights ? nullptr : edges_w.data();
+        }
+
+        weight_t total_edge_weight() const {
+            return unit_edge_weights ? (weight_t) m : sum<weight_t>(edges_w);
+        }
 
-            // skip whitespace
-            while (*p == ' ') { ++p; }
+        /**
+         * Renumbers the vertices, the new vertex u is the old vertex
+         * old_of[u]. The neighborhoods keep their order.
+         */
+        void renumber(const std::vector<vertex_t> &old_of,
+                      const u64 n_threads) {
+            std::vector<vertex_t> new_of(n);
+            parallel_for(n, n_threads, [&](u64, const u64 begin, const u64 end) {
+                for (u64 u = begin; u < end; ++u) {
+                    new_of[old_of[u]] = u;
+                }
+            });
 
-            // read number of edges - optimized parsing
-            m = 0;
-            while (*p != ' ' && *p != '\n') {
-                m = m * 10 + (vertex_t) (*p - '0');
-                ++p;
+            std::vector<u64> new_neighborhoods(n + 1);
+            std::vector<weight_t> new_v_weights(n);
+            new_neighborhoods[0] = 0;
+            for (vertex_t u = 0; u < n; ++u) {
+                const vertex_t old = old_of[u];
+                new_neighborhoods[u + 1] = new_neighborhoods[u] + (neighborhoods[old + 1] - neighborhoods[old]);
+                new_v_weights[u] = v_weights[old];
             }
-            m *= 2;
-
-            // search end of line or fmt
-            std::string fmt = "000";
-            bool has_v_weights = false;
-            bool has_e_weights = false;
-            while (*p == ' ') { ++p; }
-            if (*p != '\n') {
-                // found fmt
-                fmt[0] = *p;
-                ++p;
-                if (*p != '\n') {
-                    // found fmt
-                    fmt[1] = *p;
-                    ++p;
-                    if (*p != '\n') {
-                        // found fmt
-                        fmt[2] = *p;
-                        ++p;
+
+            std::vector<vertex_t> new_edges_v(m);
+            std::vector<weight_t> new_edges_w(unit_edge_weights ? 0 : m);
+            parallel_for_ranges(edge_balanced_ranges(new_neighborhoods.data(), n, n_threads), [&](u64, const u64 begin, const u64 end) {
+                for (u64 u = begin; u < end; ++u) {
+                    u64 src = neighborhoods[old_of[u]];
+                    for (u64 idx = new_neighborhoods[u]; idx < new_neighborhoods[u + 1]; ++idx, ++src) {
+                        new_edges_v[idx] = new_of[edges_v[src]];
+                        if (!unit_edge_weights) { new_edges_w[idx] = edges_w[src]; }
                     }
                 }
-                // skip whitespaces
-                while (*p == ' ') { ++p; }
+            });
+
+            neighborhoods = std::move(new_neighborhoods);
+            v_weights = std::move(new_v_weights);
+            edges_v.assign(std::move(new_edges_v));
+            edges_w = std::move(new_edges_w);
+
+            // the adjacency is no longer borrowed
+            munmap_file(mapping);
+            mapping = MMap();
+        }
+
+    private:
+        // file the adjacency is borrowed from, if any
+        MMap mapping;
+
+        GraphLoadObserver *observer = nullptr;
+
+        /**
+         * Notifies the observer about all vertices at once, for formats
+         * whose vertex weights are only known at the end.
+         */
+        void notify_observer() {
+            if (observer == nullptr) { return; }
+
+            observer->on_header(n, v_weights.data());
+            for (vertex_t u = 0; u < n; ++u) {
+                observer->on_vertex(u, v_weights[u]);
             }
+        }
+
+        void read_metis(const std::string &file_path) {
+            // mmap the whole file
+            MMap mm = mmap_file_ro(file_path);
+            const char *p = mm.data;
+            const char *end = mm.data + mm.size;
+
+            MetisHeader h;
+            p = parse_metis_header(p, end, h);
+            n = h.n;
+            m = h.m;
+
             vertex_weights = 0;
             v_weights.resize(n);
+            if (observer != nullptr) { observer->on_header(n, v_weights.data()); }
             neighborhoods.resize(n + 1);
             neighborhoods[0] = 0;
             edges_v.resize(m);
-            edges_w.resize(m);
-            has_v_weights = fmt[1] == '1';
-            has_e_weights = fmt[2] == '1';
+            unit_edge_weights = !h.has_e_weights;
+            if (!unit_edge_weights) { edges_w.resize(m); }
+
+            // plain pointers, so the compiler keeps them in registers while
+            // storing the edges
+            vertex_t *e_v = edges_v.data();
+            weight_t *e_w = unit_edge_weights ? nullptr : edges_w.data();
 
-            ++p;
             vertex_t u = 0;
             size_t curr_m = 0;
 
-            while (p < end) {
-                // skip comment lines
-                while (*p == '%') {
-                    while (*p != '\n') { ++p; }
-                    ++p;
+            while (u < n) {
+                p = skip_metis_comments(p, end);
+                if (p >= end) {
+                    std::cerr << "Graph has " << u << " vertices, but " << n << " were expected!\n";
+                    munmap_file(mm);
+                    exit(EXIT_FAILURE);
                 }
 
-                // skip whitespaces
-                while (*p == ' ') { ++p; }
-
-                // read in vertex weight - optimized
-                weight_t vw = 1;
-                if (has_v_weights) {
-                    vw = 0;
-                    while (*p != ' ' && *p != '\n') {
-                        vw = vw * 10 + (weight_t) (*p - '0');
-                        ++p;
+                weight_t vw;
+                p = parse_metis_vertex(p, end, h, vw, [&](const vertex_t v, const weight_t w) {
+                    // too many edges are reported below
+                    if (curr_m < m) {
+                        e_v[curr_m] = v;
+                        if (e_w != nullptr) { e_w[curr_m] = w; }
                     }
-                    // skip whitespaces
-                    while (*p == ' ') { ++p; }
-                }
+                    ++curr_m;
+                });
                 v_weights[u] = vw;
                 vertex_weights += vw;
+                if (observer != nullptr) { observer->on_vertex(u, vw); }
 
-                // read in edges - optimized inner loop
-                while (*p != '\n' && p < end) {
-                    vertex_t v = 0;
-                    while (*p != ' ' && *p != '\n') {
-                        v = v * 10 + (vertex_t) (*p - '0');
-                        ++p;
-                    }
-
-                    // skip whitespaces
-                    while (*p == ' ') { ++p; }
-
-                    weight_t w = 1;
-                    if (has_e_weights) {
-                        w = 0;
-                        while (*p != ' ' && *p != '\n') {
-                            w = w * 10 + (weight_t) (*p - '0');
-                            ++p;
-                        }
-                        // skip whitespaces
-                        while (*p == ' ') { ++p; }
-                    }
-
-                    edges_v[curr_m] = v - 1;
-                    edges_w[curr_m] = w;
-                    ++curr_m;
-                }
                 neighborhoods[u + 1] = (vertex_t) curr_m;
                 ++u;
-                ++p;
+            }
+
+            // only empty lines and comments may follow
+            while (p < end) {
+                p = skip_spaces(skip_metis_comments(p, end), end);
+                if (p < end && *p != '\n') {
+                    std::cerr << "Graph has more than the " << n << " expected vertices!\n";
+                    munmap_file(mm);
+                    exit(EXIT_FAILURE);
+                }
+                p = skip_line(p, end);
             }
 
             if (curr_m != m) {
@@ -176,6 +355,121 @@ namespace ProMapAnalyzer {
             // done with the file
             munmap_file(mm);
         }
+
+        /**
+         * The targets are used in place from a read-only mapping of the file,
+         * only the byte offsets are converted into a new array.
+         */
+        void read_parhip(const std::string &file_path,
+                         const u64 n_threads) {
+            mapping = mmap_file_lazy(file_path);
+
+            const u64 *header = reinterpret_cast<const u64 *>(mapping.data);
+            n = header[1];
+            m = header[2];
+
+            const u64 *offsets = header + 3;
+            const u64 base = PARHIP_HEADER_SIZE + (n + 1) * sizeof(u64);
+            if (offsets[0] != base || offsets[n] != base + m * sizeof(u64)) {
+                std::cerr << "Offsets of ParHIP graph " << file_path << " do not match its header!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            // the first invalid offset of every thread, n + 1 if there is none
+            std::vector<u64> bounds = uniform_ranges(n + 1, n_threads);
+            std::vector<u64> first_invalid(bounds.size() - 1, n + 1);
+            neighborhoods.resize(n + 1);
+            parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 end) {
+                for (u64 i = begin; i < end; ++i) {
+                    if (!valid_parhip_offset(offsets[i], i == 0 ? base : offsets[i - 1], base, m)) {
+                        first_invalid[t] = i;
+                        return;
+                    }
+                    neighborhoods[i] = (offsets[i] - base) / sizeof(u64);
+                }
+            });
+            const u64 u = *std::min_element(first_invalid.begin(), first_invalid.end());
+            if (u <= n) { invalid_parhip_offset(file_path, u, offsets[u]); }
+            edges_v.borrow(reinterpret_cast<vertex_t *>(mapping.data + base), m);
+
+            // ParHIP graphs are unweighted
+            unit_edge_weights = true;
+            v_weights.assign(n, 1);
+            vertex_weights = (weight_t) n;
+            notify_observer();
+        }
+
+        void read_matrix_market(const std::string &file_path,
+                                const u64 n_threads) {
+            MMap mm = mmap_file_ro(file_path);
+            const char *p = mm.data;
+            const char *end = mm.data + mm.size;
+
+            // %%MatrixMarket matrix coordinate <field> <symmetry>
+            std::string banner(p, find_newline(p, end));
+            std::replace(banner.begin(), banner.end(), '\t', ' ');
+            std::replace(banner.begin(), banner.end(), '\r', ' ');
+            std::vector<std::string> tokens = split(banner, ' ');
+            for (auto &t: tokens) {
+                std::transform(t.begin(), t.end(), t.begin(), ::tolower);
+            }
+            if (tokens.size() < 4 || tokens[1] != "matrix" || tokens[2] != "coordinate") {
+                std::cerr << "Only Matrix Market files of type 'matrix coordinate' are supported!" << std::endl;
+                munmap_file(mm);
+                exit(EXIT_FAILURE);
+            }
+            // only integer values are used as edge weights
+            const bool read_weight = tokens[3] == "integer";
+
+            // size line "rows cols nnz" after the comments
+            p = skip_line(p, end);
+            while (p < end && *p == '%') { p = skip_line(p, end); }
+            p = skip_spaces(p, end);
+            const u64 rows = parse_uint(p, end);
+            p = skip_spaces(p, end);
+            const u64 cols = parse_uint(p, end);
+            p = skip_line(p, end);
+            if (rows != cols) {
+                std::cerr << "Matrix " << file_path << " is not square (" << rows << "x" << cols << ")!" << std::endl;
+                munmap_file(mm);
+                exit(EXIT_FAILURE);
+            }
+
+            vertex_t max_n = 0;
+            std::vector<std::vector<CooEdge> > chunks = parse_coo_parallel(p, end, 1, read_weight, n_threads, max_n, mm.data, file_path);
+            munmap_file(mm);
+
+            if (max_n > rows) {
+                std::cerr << "Matrix " << file_path << " has an entry outside of its " << rows << " rows!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            build_from_coo(rows, chunks, n_threads);
+        }
+
+        void read_edge_list(const std::string &file_path,
+                            const u64 n_threads) {
+            MMap mm = mmap_file_ro(file_path);
+
+            vertex_t max_n = 0;
+            std::vector<std::vector<CooEdge> > chunks = parse_coo_parallel(mm.data, mm.data + mm.size, 0, true, n_threads, max_n, mm.data, file_path);
+            munmap_file(mm);
+
+            build_from_coo(max_n, chunks, n_threads);
+        }
+
+        void build_from_coo(const vertex_t t_n,
+                            const std::vector<std::vector<CooEdge> > &chunks,
+                            const u64 n_threads) {
+            std::vector<vertex_t> targets;
+            coo_to_csr(t_n, chunks, n_threads, neighborhoods, targets, edges_w);
+
+            n = t_n;
+            m = targets.size();
+            edges_v.assign(std::move(targets));
+            v_weights.assign(n, 1);
+            vertex_weights = (weight_t) n;
+            notify_observer();
+        }
     };
 }
 
@@ -0,0 +1,309 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_GRAPH_IO_H
+#define PROCESSMAPPINGANALYZER_GRAPH_IO_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "definitions.h"
+#include "parallel_util.h"
+#include "tokenizer.h"
+#include "util.h"
+
+namespace ProMapAnalyzer {
+    enum class GraphFormat {
+        METIS,
+        PARHIP,
+        MATRIX_MARKET,
+        EDGE_LIST
+    };
+
+    inline std::string to_string(const GraphFormat format) {
+        switch (format) {
+            case GraphFormat::METIS: return "metis";
+            case GraphFormat::PARHIP: return "parhip";
+            case GraphFormat::MATRIX_MARKET: return "mtx";
+            case GraphFormat::EDGE_LIST: return "edgelist";
+        }
+        return "unknown";
+    }
+
+    // ParHIP binary: version, n, number of directed edges, n + 1 byte
+    // offsets into the file, then the 0-based targets, all 64 bit
+    constexpr u64 PARHIP_VERSION_UNWEIGHTED = 3;
+    constexpr u64 PARHIP_HEADER_SIZE = 3 * sizeof(u64);
+
+    /**
+     * Whether a byte offset of a ParHIP graph, whose targets start at base,
+     * points to one of the m targets (or behind the last one) and does not
+     * come before the offset prev of the previous vertex.
+     */
+    inline bool valid_parhip_offset(const u64 offset,
+                                    const u64 prev,
+                                    const u64 base,
+                                    const u64 m) {
+        return offset >= prev && offset >= base && offset <= base + m * sizeof(u64) && (offset - base) % sizeof(u64) == 0;
+    }
+
+    inline void invalid_parhip_offset(const std::string &file_path,
+                                      const u64 u,
+                                      const u64 offset) {
+        std::cerr << "Offset " << offset << " of vertex " << u << " in ParHIP graph " << file_path << " is out of order or out of range!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    inline bool ends_with(const std::string &str,
+                          const std::string &suffix) {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    /**
+     * Detects the format of a graph file from its header, falling back to
+     * the extension for edge lists and to METIS otherwise.
+     */
+    inline GraphFormat detect_graph_format(const std::string &path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        const u64 file_size = (u64) file.tellg();
+        file.seekg(0);
+
+        char head[PARHIP_HEADER_SIZE] = {};
+        file.read(head, sizeof(head));
+        const u64 n_read = (u64) file.gcount();
+
+        const std::string mtx_banner = "%%MatrixMarket";
+        if (n_read >= mtx_banner.size() && std::string(head, mtx_banner.size()) == mtx_banner) {
+            return GraphFormat::MATRIX_MARKET;
+        }
+
+        if (n_read == PARHIP_HEADER_SIZE) {
+            u64 header[3];
+            std::memcpy(header, head, sizeof(header));
+            // the size of the file has to match n and m exactly
+            const u64 version = header[0], n = header[1], m = header[2];
+            if (version == PARHIP_VERSION_UNWEIGHTED && n < file_size && m < file_size &&
+                file_size == PARHIP_HEADER_SIZE + (n + 1) * sizeof(u64) + m * sizeof(u64)) {
+                return GraphFormat::PARHIP;
+            }
+        }
+
+        if (ends_with(path, ".mtx")) { return GraphFormat::MATRIX_MARKET; }
+        if (ends_with(path, ".el") || ends_with(path, ".edges") || ends_with(path, ".edgelist")) { return GraphFormat::EDGE_LIST; }
+        return GraphFormat::METIS;
+    }
+
+    struct CooEdge {
+        vertex_t u;
+        vertex_t v;
+        weight_t w;
+    };
+
+    /**
+     * Reports the line starting at line of the file mapped at file_begin
+     * and exits. Only called on errors, so the line number is counted then.
+     */
+    inline void invalid_coo_line(const std::string &file_path,
+                                 const char *file_begin,
+                                 const char *line,
+                                 const char *end,
+                                 const std::string &reason) {
+        const u64 line_number = 1 + (u64) std::count(file_begin, line, '\n');
+        std::cerr << reason << " '" << std::string(line, find_newline(line, end)) << "' in line " << line_number << " of " << file_path << "!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    /**
+     * Reads "u v [w]" lines from [p, end) that start with a line. Lines
+     * starting with '%' or '#' and blank lines are skipped, ids are shifted
+     * by -base. If read_weight is false, everything after v is ignored,
+     * otherwise a missing weight is 1 and weights have to be positive.
+     * Errors are reported with their line in the file starting at
+     * file_begin.
+     */
+    inline void parse_coo_lines(const char *p,
+                                const char *end,
+                                const u64 base,
+                                const bool read_weight,
+                                std::vector<CooEdge> &edges,
+                                vertex_t &max_id,
+                                const char *file_begin,
+                                const std::string &file_path) {
+        while (p < end) {
+            p = skip_spaces(p, end);
+            if (p >= end) { break; }
+            if (*p == '\n' || *p == '%' || *p == '#') {
+                p = skip_line(p, end);
+                continue;
+            }
+
+            const char *line = p;
+            const char *q = p;
+            const vertex_t u = parse_uint(p, end);
+            const bool valid_u = p != q;
+            p = skip_spaces(p, end);
+            q = p;
+            const vertex_t v = parse_uint(p, end);
+            const bool valid_v = p != q;
+
+            if (!valid_u || !valid_v || u < base || v < base) {
+                invalid_coo_line(file_path, file_begin, line, end, "Invalid edge");
+            }
+
+            weight_t w = 1;
+            if (read_weight) {
+                p = skip_spaces(p, end);
+                if (p < end && *p == '-') {
+                    invalid_coo_line(file_path, file_begin, line, end, "Negative edge weight");
+                }
+                q = p;
+                const weight_t x = (weight_t) parse_uint(p, end);
+                if (p != q) {
+                    if (x == 0) { invalid_coo_line(file_path, file_begin, line, end, "Edge weight 0"); }
+                    w = x;
+                }
+            }
+
+            edges.push_back({u - base, v - base, w});
+            max_id = std::max(max_id, std::max(u, v) - base);
+            p = skip_line(p, end);
+        }
+    }
+
+    /**
+     * Parses [p, end) of the file mapped at file_begin with parse_coo_lines
+     * on n_threads threads, each starting at the first full line of its
+     * share of the bytes.
+     */
+    inline std::vector<std::vector<CooEdge> > parse_coo_parallel(const char *p,
+                                                                 const char *end,
+                                                                 const u64 base,
+                                                                 const bool read_weight,
+                                                                 const u64 n_threads,
+                                                                 vertex_t &n,
+                                                                 const char *file_begin,
+                                                                 const std::string &file_path) {
+        const u64 size = (u64) (end - p);
+        std::vector<u64> bounds = uniform_ranges(size, n_threads);
+        for (size_t t = 1; t + 1 < bounds.size(); ++t) {
+            const char *line = p + bounds[t];
+            // a share starts behind the newline that ends the previous line
+            bounds[t] = (u64) (skip_line(line - 1, end) - p);
+            bounds[t] = std::max(bounds[t], bounds[t - 1]);
+        }
+
+        std::vector<std::vector<CooEdge> > chunks(bounds.size() - 1);
+        std::vector<vertex_t> max_ids(bounds.size() - 1, 0);
+        parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 stop) {
+            chunks[t].reserve((stop - begin) / 8);
+            parse_coo_lines(p + begin, p + stop, base, read_weight, chunks[t], max_ids[t], file_begin, file_path);
+        });
+
+        n = 0;
+        for (size_t t = 0; t < chunks.size(); ++t) {
+            if (!chunks[t].empty()) { n = std::max(n, max_ids[t] + 1); }
+        }
+        return chunks;
+    }
+
+    /**
+     * Builds a symmetric CSR from the coordinate lists. Every entry is
+     * inserted in both directions, self-loops are dropped and duplicates of
+     * an edge are merged into one edge with the largest weight.
+     */
+    inline void coo_to_csr(const vertex_t n,
+                           const std::vector<std::vector<CooEdge> > &chunks,
+                           const u64 n_threads,
+                           std::vector<u64> &neighborhoods,
+                           std::vector<vertex_t> &edges_v,
+                           std::vector<weight_t> &edges_w) {
+        std::vector<u64> chunk_bounds(chunks.size() + 1);
+        std::iota(chunk_bounds.begin(), chunk_bounds.end(), 0);
+
+        // degrees with duplicates
+        std::vector<std::atomic<u64> > pos(n);
+        parallel_for_ranges(chunk_bounds, [&](const u64 t, u64, u64) {
+            for (const CooEdge &e: chunks[t]) {
+                if (e.u == e.v) { continue; }
+                pos[e.u].fetch_add(1, std::memory_order_relaxed);
+                pos[e.v].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        std::vector<u64> offsets(n + 1, 0);
+        for (vertex_t u = 0; u < n; ++u) {
+            offsets[u + 1] = offsets[u] + pos[u].load(std::memory_order_relaxed);
+            pos[u].store(offsets[u], std::memory_order_relaxed);
+        }
+
+        // scatter both directions
+        std::vector<std::pair<vertex_t, weight_t> > adj(offsets[n]);
+        parallel_for_ranges(chunk_bounds, [&](const u64 t, u64, u64) {
+            for (const CooEdge &e: chunks[t]) {
+                if (e.u == e.v) { continue; }
+                adj[pos[e.u].fetch_add(1, std::memory_order_relaxed)] = {e.v, e.w};
+                adj[pos[e.v].fetch_add(1, std::memory_order_relaxed)] = {e.u, e.w};
+            }
+        });
+
+        // sort every neighborhood and merge duplicates in place
+        std::vector<u64> degrees(n + 1, 0);
+        parallel_for_ranges(edge_balanced_ranges(offsets.data(), n, n_threads), [&](u64, const u64 begin, const u64 stop) {
+            for (u64 u = begin; u < stop; ++u) {
+                auto first = adj.begin() + (s64) offsets[u];
+                auto last = adj.begin() + (s64) offsets[u + 1];
+                std::sort(first, last);
+
+                u64 d = 0;
+                for (auto it = first; it != last; ++it) {
+                    if (d > 0 && (first + (s64) d - 1)->first == it->first) {
+                        (first + (s64) d - 1)->second = std::max((first + (s64) d - 1)->second, it->second);
+                    } else {
+                        *(first + (s64) d) = *it;
+                        ++d;
+                    }
+                }
+                degrees[u + 1] = d;
+            }
+        });
+
+        neighborhoods.assign(n + 1, 0);
+        for (vertex_t u = 0; u < n; ++u) {
+            neighborhoods[u + 1] = neighborhoods[u] + degrees[u + 1];
+        }
+
+        edges_v.resize(neighborhoods[n]);
+        edges_w.resize(neighborhoods[n]);
+        parallel_for_ranges(edge_balanced_ranges(neighborhoods.data(), n, n_threads), [&](u64, const u64 begin, const u64 stop) {
+            for (u64 u = begin; u < stop; ++u) {
+                u64 src = offsets[u];
+                for (u64 idx = neighborhoods[u]; idx < neighborhoods[u + 1]; ++idx, ++src) {
+                    edges_v[idx] = adj[src].first;
+                    edges_w[idx] = adj[src].second;
+                }
+            }
+        });
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_GRAPH_IO_H
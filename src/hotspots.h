@@ -0,0 +1,181 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_HOTSPOTS_H
+#define PROCESSMAPPINGANALYZER_HOTSPOTS_H
+
+#include <algorithm>
+#include <vector>
+
+#include "definitions.h"
+
+namespace ProMapAnalyzer {
+    /**
+     * Vertex with its communication cost, the summed weight times distance of
+     * its cut edges, and the number of its cut edges.
+     */
+    struct HotVertex {
+        vertex_t u;
+        u64 block;
+        u64 comm_cost;
+        u64 edge_cut;
+
+        bool ranks_before(const HotVertex &other) const {
+            return comm_cost != other.comm_cost ? comm_cost > other.comm_cost : u < other.u;
+        }
+    };
+
+    /**
+     * Cut edge {u, v} with u < v, the layer it is cut on and its weight times
+     * the distance of that layer.
+     */
+    struct HotEdge {
+        vertex_t u;
+        vertex_t v;
+        u64 u_block;
+        u64 v_block;
+        u64 layer;
+        u64 weight;
+        u64 comm_cost;
+
+        bool ranks_before(const HotEdge &other) const {
+            if (comm_cost != other.comm_cost) { return comm_cost > other.comm_cost; }
+            if (layer != other.layer) { return layer > other.layer; }
+            return u != other.u ? u < other.u : v < other.v;
+        }
+    };
+
+    /**
+     * The n highest ranked elements seen so far. They are kept in a heap whose
+     * front is the lowest ranked of them, so an element that does not make it
+     * is rejected with a single comparison.
+     */
+    template<typename T>
+    class TopN {
+    public:
+        explicit TopN(const u64 t_n = 0) : n(t_n) {
+            heap.reserve(n);
+        }
+
+        /**
+         * Elements of lower cost can not enter anymore.
+         */
+        u64 min_cost() const { return min_comm_cost; }
+
+        void add(const T &x) {
+            if (heap.size() < n) {
+                heap.push_back(x);
+                std::push_heap(heap.begin(), heap.end(), rank);
+            } else if (n > 0 && x.ranks_before(heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), rank);
+                heap.back() = x;
+                std::push_heap(heap.begin(), heap.end(), rank);
+            } else {
+                return;
+            }
+            if (heap.size() == n) { min_comm_cost = heap.front().comm_cost; }
+        }
+
+        void merge(const TopN &other) {
+            for (const T &x: other.heap) { add(x); }
+        }
+
+        /**
+         * The kept elements, highest ranked first.
+         */
+        std::vector<T> sorted() const {
+            std::vector<T> res = heap;
+            std::sort(res.begin(), res.end(), rank);
+            return res;
+        }
+
+    private:
+        u64 n;
+        u64 min_comm_cost = 0;
+        std::vector<T> heap;
+
+        static bool rank(const T &a,
+                         const T &b) { return a.ranks_before(b); }
+    };
+
+    /**
+     * Collects the top vertices and cut edges during the stats sweep, see
+     * accumulate_stats. Every thread fills its own instance, they are merged
+     * afterwards, so no sweep needs more than O(n_hotspots) extra memory.
+     *
+     * If the graph was renumbered, old_of (as in determine_order) maps the
+     * ids back. Vertices are ranked and reported by their original ids, so
+     * the selection does not depend on the vertex order.
+     */
+    struct Hotspots {
+        u64 n_hotspots = 0;
+        const vertex_t *old_of = nullptr;
+        TopN<HotVertex> vertices;
+        TopN<HotEdge> edges;
+
+        explicit Hotspots(const u64 t_n_hotspots = 0,
+                          const vertex_t *t_old_of = nullptr) : n_hotspots(t_n_hotspots),
+                                                                old_of(t_old_of),
+                                                                vertices(t_n_hotspots),
+                                                                edges(t_n_hotspots) {
+        }
+
+        vertex_t original_id(const vertex_t u) const {
+            return old_of == nullptr ? u : old_of[u];
+        }
+
+        void vertex(const vertex_t u,
+                    const u64 block,
+                    const u64 comm_cost,
+                    const u64 edge_cut) {
+            if (comm_cost > 0 && comm_cost >= vertices.min_cost()) { vertices.add({original_id(u), block, comm_cost, edge_cut}); }
+        }
+
+        /**
+         * Called for both directions of an edge, only (u, v) with u < v in
+         * original ids is kept.
+         */
+        void edge(const vertex_t u,
+                  const vertex_t v,
+                  const u64 u_block,
+                  const u64 v_block,
+                  const u64 layer,
+                  const u64 weight,
+                  const u64 comm_cost) {
+            if (comm_cost >= edges.min_cost()) {
+                const vertex_t o_u = original_id(u);
+                const vertex_t o_v = original_id(v);
+                if (o_u < o_v) { edges.add({o_u, o_v, u_block, v_block, layer, weight, comm_cost}); }
+            }
+        }
+
+        void merge(const Hotspots &other) {
+            vertices.merge(other.vertices);
+            edges.merge(other.edges);
+        }
+    };
+
+    /**
+     * Collector for sweeps without hotspot report, compiles to nothing.
+     */
+    struct NoHotspots {
+        void vertex(vertex_t, u64, u64, u64) {}
+
+        void edge(vertex_t, vertex_t, u64, u64, u64, u64, u64) {}
+    };
+}
+
+#endif //PROCESSMAPPINGANALYZER_HOTSPOTS_H
@@ -0,0 +1,138 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_LOAD_PIPELINE_H
+#define PROCESSMAPPINGANALYZER_LOAD_PIPELINE_H
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "util.h"
+
+namespace ProMapAnalyzer {
+    /**
+     * Reads and checks the partition on its own thread while the graph is
+     * parsed, and accumulates the block weights from the vertex weights the
+     * parser reports. Vertices reported before the partition is available
+     * are caught up from the graph's vertex weights on the first vertex
+     * after it became available, or in finish().
+     *
+     * A block id >= k and a vertex count that differs from the graph header
+     * terminate the program as soon as both sides are known, without
+     * waiting for the rest of the graph.
+     */
+    class PartitionLoader : public GraphLoadObserver {
+    public:
+        PartitionLoader(const std::string &t_path,
+                        const u64 t_k) : path(t_path), k(t_k), block_weights(t_k, 0) {
+            thread = std::thread([this]() { load(); });
+        }
+
+        ~PartitionLoader() override {
+            if (thread.joinable()) { thread.join(); }
+        }
+
+        PartitionLoader(const PartitionLoader &) = delete;
+
+        PartitionLoader &operator=(const PartitionLoader &) = delete;
+
+        void on_header(const vertex_t n, const weight_t *t_v_weights) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            graph_n = n;
+            v_weights = t_v_weights;
+            if (ready.load(std::memory_order_relaxed)) { check_size(); }
+            has_header = true;
+        }
+
+        void on_vertex(const vertex_t u, const weight_t w) override {
+            if (!caught_up) {
+                if (!ready.load(std::memory_order_acquire)) { return; }
+                catch_up(u);
+            }
+            block_weights[partition[u]] += w;
+        }
+
+        /**
+         * Waits for the partition and returns the weight of every block.
+         */
+        std::vector<u64> finish(const Graph &g) {
+            thread.join();
+            if (!has_header) { on_header(g.n, g.v_weights.data()); }
+            if (!caught_up) { catch_up(g.n); }
+            return std::move(block_weights);
+        }
+
+        std::vector<u64> &get_partition() { return partition; }
+
+    private:
+        std::string path;
+        u64 k;
+
+        std::thread thread;
+        std::mutex mutex;
+        std::atomic<bool> ready{false};
+
+        std::vector<u64> partition;
+        std::vector<u64> block_weights;
+
+        // written under the mutex by the parser, read by the loader
+        bool has_header = false;
+        vertex_t graph_n = 0;
+        const weight_t *v_weights = nullptr;
+
+        // only touched by the parser
+        bool caught_up = false;
+
+        void load() {
+            partition = read_partition(path, 0);
+
+            for (const u64 id: partition) {
+                if (id >= k) {
+                    std::cout << "Partition contains id " << max(partition) << " which is greater than k=" << k << std::endl;
+                    // the graph is still being read on the main thread
+                    std::_Exit(EXIT_FAILURE);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (has_header) { check_size(); }
+            ready.store(true, std::memory_order_release);
+        }
+
+        void check_size() const {
+            if (graph_n != partition.size()) {
+                std::cout << "Graph (n=" << graph_n << ") and partition (n=" << partition.size() << ") do not have same number of vertices!" << std::endl;
+                std::_Exit(EXIT_FAILURE);
+            }
+        }
+
+        void catch_up(const vertex_t u) {
+            for (vertex_t v = 0; v < u; ++v) {
+                block_weights[partition[v]] += v_weights[v];
+            }
+            caught_up = true;
+        }
+    };
+}
+
+#endif //PROCESSMAPPINGANALYZER_LOAD_PIPELINE_H
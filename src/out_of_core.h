@@ -0,0 +1,575 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_OUT_OF_CORE_H
+#define PROCESSMAPPINGANALYZER_OUT_OF_CORE_H
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "parallel_util.h"
+#include "partition_util.h"
+#include "util.h"
+
+namespace ProMapAnalyzer {
+    /**
+     * Partition stored with ceil(log2(k)) bits per vertex.
+     */
+    class PackedPartition {
+    public:
+        u64 n = 0;
+        u64 bits = 1;
+        u64 mask = 1;
+        std::vector<u64> words;
+
+        PackedPartition(const u64 t_n, const u64 k) : n(t_n) {
+            bits = 1;
+            while (bits < 64 && (1ULL << bits) < k) { ++bits; }
+            mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+
+            // one padding word, so that operator[] may always read two words
+            words.resize((n * bits + 63) / 64 + 1, 0);
+        }
+
+        void set(const u64 i, const u64 x) {
+            const u64 pos = i * bits;
+            const u64 w = pos >> 6;
+            const u64 off = pos & 63;
+
+            words[w] &= ~(mask << off);
+            words[w] |= x << off;
+            if (off + bits > 64) {
+                words[w + 1] &= ~(mask >> (64 - off));
+                words[w + 1] |= x >> (64 - off);
+            }
+        }
+
+        u64 operator[](const u64 i) const {
+            const u64 pos = i * bits;
+            const u64 w = pos >> 6;
+            const u64 off = pos & 63;
+
+            u64 x = words[w] >> off;
+            if (off + bits > 64) {
+                x |= words[w + 1] << (64 - off);
+            }
+            return x & mask;
+        }
+
+        u64 memory() const {
+            return words.size() * sizeof(u64);
+        }
+    };
+
+    /**
+     * Reads a file line by line through a buffer of fixed size, which only
+     * grows for lines longer than the buffer.
+     */
+    class LineReader {
+    public:
+        LineReader(const std::string &file_path,
+                   const u64 buffer_bytes) : buf(std::max<u64>(buffer_bytes, 1 << 12)) {
+            if (!file_exists(file_path)) {
+                std::cerr << "File " << file_path << " does not exist!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                perror("open");
+                std::exit(EXIT_FAILURE);
+            }
+            #ifdef __linux__
+            (void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            #endif
+        }
+
+        ~LineReader() {
+            if (fd >= 0) { ::close(fd); }
+        }
+
+        LineReader(const LineReader &) = delete;
+
+        LineReader &operator=(const LineReader &) = delete;
+
+        /**
+         * Makes sure the next full line is in the buffer and returns it
+         * without the trailing newline. Returns false at the end of the file.
+         */
+        bool peek_line(const char *&p, const char *&e) {
+            p = e = nullptr;
+            size_t scanned = pos;
+            while (true) {
+                const char *nl = static_cast<const char *>(std::memchr(buf.data() + scanned, '\n', len - scanned));
+                if (nl != nullptr) {
+                    p = buf.data() + pos;
+                    e = nl;
+                    return true;
+                }
+                if (eof) {
+                    if (pos == len) { return false; }
+                    // last line without newline
+                    p = buf.data() + pos;
+                    e = buf.data() + len;
+                    return true;
+                }
+
+                // move the partial line to the front and read more
+                scanned = len - pos;
+                std::memmove(buf.data(), buf.data() + pos, len - pos);
+                len -= pos;
+                pos = 0;
+                if (len == buf.size()) {
+                    // line longer than the buffer
+                    buf.resize(buf.size() * 2);
+                }
+
+                const ssize_t r = ::read(fd, buf.data() + len, buf.size() - len);
+                if (r < 0) {
+                    perror("read");
+                    std::exit(EXIT_FAILURE);
+                }
+                eof = r == 0;
+                len += (size_t) r;
+            }
+        }
+
+        void consume(const char *e) {
+            pos = std::min(len, (size_t) (e - buf.data()) + 1);
+        }
+
+    private:
+        int fd = -1;
+        std::vector<char> buf;
+        size_t pos = 0;
+        size_t len = 0;
+        bool eof = false;
+    };
+
+    /**
+     * Reads the partition directly into packed form, through a buffer of
+     * buffer_bytes. Fails as soon as an id >= k or more than partition.n
+     * entries are found.
+     */
+    inline void read_packed_partition(const std::string &path,
+                                      PackedPartition &partition,
+                                      const u64 k,
+                                      const u64 buffer_bytes) {
+        const u64 n = partition.n;
+        LineReader lines(path, buffer_bytes);
+
+        u64 i = 0;
+        const char *p, *e;
+        while (lines.peek_line(p, e)) {
+            // Skip lines starting with 'c'
+            if (p < e && *p == 'c') {
+                lines.consume(e);
+                continue;
+            }
+
+            u64 value = 0;
+            std::from_chars(p, e, value);
+
+            if (i >= n) {
+                std::cout << "Partition has more than n=" << n << " entries!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            if (value >= k) {
+                std::cout << "Partition contains id " << value << " which is greater than k=" << k << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            partition.set(i++, value);
+            lines.consume(e);
+        }
+
+        if (i != n) {
+            std::cout << "Graph (n=" << n << ") and partition (n=" << i << ") do not have same number of vertices!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /**
+     * Consecutive vertices [first_vertex, first_vertex + n) of a graph. The
+     * offsets in neighborhoods are local, the neighbor ids are global.
+     */
+    struct GraphSegment {
+        u64 first_vertex = 0;
+        u64 n = 0;
+
+        std::vector<u64> neighborhoods;
+        std::vector<vertex_t> edges_v;
+        std::vector<weight_t> edges_w;
+        std::vector<weight_t> v_weights;
+
+        // capacity, a segment is full once either is reached
+        u64 max_vertices = 0;
+        u64 max_edges = 0;
+
+        /**
+         * Allocates room for exactly n_vertices vertices and n_edges edges.
+         */
+        void reserve(const u64 n_vertices, const u64 n_edges) {
+            max_vertices = n_vertices;
+            max_edges = n_edges;
+            neighborhoods.reserve(n_vertices + 1);
+            v_weights.reserve(n_vertices);
+            edges_v.reserve(n_edges);
+            edges_w.reserve(n_edges);
+        }
+
+        bool fits(const u64 n_vertices, const u64 n_edges) const {
+            return n_vertices <= max_vertices && n_edges <= max_edges;
+        }
+
+        void clear() {
+            // a single oversized vertex may have grown the edge arrays
+            if (edges_v.capacity() > max_edges || edges_w.capacity() > max_edges) {
+                std::vector<vertex_t>().swap(edges_v);
+                std::vector<weight_t>().swap(edges_w);
+                edges_v.reserve(max_edges);
+                edges_w.reserve(max_edges);
+            }
+            first_vertex = 0;
+            n = 0;
+            neighborhoods.clear();
+            neighborhoods.push_back(0);
+            edges_v.clear();
+            edges_w.clear();
+            v_weights.clear();
+        }
+
+        /**
+         * Bytes allocated by the segment.
+         */
+        u64 bytes() const {
+            return neighborhoods.capacity() * sizeof(u64) + v_weights.capacity() * sizeof(weight_t) +
+                   edges_v.capacity() * sizeof(vertex_t) + edges_w.capacity() * sizeof(weight_t);
+        }
+
+        /**
+         * Number of vertices and edges that fit into max_bytes, split by the
+         * average degree, but at least a quarter of the bytes for each.
+         */
+        static void capacity(const u64 max_bytes,
+                             const f64 avg_degree,
+                             u64 &n_vertices,
+                             u64 &n_edges) {
+            const f64 vertex_share = std::clamp(1.0 / (1.0 + avg_degree), 0.25, 0.75);
+            const u64 vertex_bytes = (u64) ((f64) max_bytes * vertex_share);
+            n_vertices = std::max<u64>(1, vertex_bytes / (sizeof(u64) + sizeof(weight_t)) - 1);
+            n_edges = (max_bytes - vertex_bytes) / (sizeof(vertex_t) + sizeof(weight_t));
+        }
+    };
+
+    /**
+     * Reads a graph in METIS format segment by segment through a fixed-size
+     * buffer, never holding more than one segment of adjacency in memory.
+     */
+    class MetisSegmentReader {
+    public:
+        vertex_t n = 0;
+        vertex_t m = 0;
+
+        MetisSegmentReader(const std::string &file_path,
+                           const u64 buffer_bytes) : lines(file_path, buffer_bytes) {
+            // header, skipping comment lines
+            const char *p, *e;
+            while (lines.peek_line(p, e) && *p == '%') { lines.consume(e); }
+            if (p == nullptr) {
+                std::cerr << "File " << file_path << " has no header!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            lines.consume(e);
+
+            parse_metis_header(p, e, header);
+            n = header.n;
+            m = header.m;
+        }
+
+        MetisSegmentReader(const MetisSegmentReader &) = delete;
+
+        MetisSegmentReader &operator=(const MetisSegmentReader &) = delete;
+
+        /**
+         * Fills seg with the next vertices, as long as they fit into its
+         * capacity. A single vertex is always read, even if it is larger.
+         * Returns false once all n vertices have been read.
+         */
+        bool next(GraphSegment &seg) {
+            seg.clear();
+            seg.first_vertex = n_read;
+
+            const char *p, *e;
+            while (n_read < n) {
+                if (!lines.peek_line(p, e)) {
+                    std::cerr << "Graph has " << n_read << " vertices, but " << n << " were expected!\n";
+                    exit(EXIT_FAILURE);
+                }
+
+                // skip comment lines
+                if (*p == '%') {
+                    lines.consume(e);
+                    continue;
+                }
+
+                // a line of length l holds at most (l + 1) / 2 numbers
+                const u64 max_entries = (u64) (e - p + 1) / 2;
+                if (seg.n > 0 && !seg.fits(seg.n + 1, seg.edges_v.size() + max_entries)) {
+                    break;
+                }
+
+                weight_t vw;
+                parse_metis_vertex(p, e, header, vw, [&](const vertex_t v, const weight_t w) {
+                    seg.edges_v.push_back(v);
+                    seg.edges_w.push_back(w);
+                });
+                seg.v_weights.push_back(vw);
+                seg.neighborhoods.push_back(seg.edges_v.size());
+                seg.n += 1;
+                n_read += 1;
+
+                lines.consume(e);
+            }
+
+            return seg.n > 0;
+        }
+
+    private:
+        MetisHeader header;
+        LineReader lines;
+        u64 n_read = 0;
+    };
+
+    /**
+     * Reads a ParHIP binary graph segment by segment with pread, never
+     * holding more than one segment of adjacency in memory.
+     */
+    class ParhipSegmentReader {
+    public:
+        vertex_t n = 0;
+        vertex_t m = 0;
+
+        explicit ParhipSegmentReader(const std::string &t_file_path) : file_path(t_file_path) {
+            fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                perror("open");
+                std::exit(EXIT_FAILURE);
+            }
+
+            u64 header[3];
+            pread_all(fd, header, sizeof(header), 0);
+            n = header[1];
+            m = header[2];
+            base = PARHIP_HEADER_SIZE + (n + 1) * sizeof(u64);
+            prev_offset = base;
+        }
+
+        ~ParhipSegmentReader() {
+            if (fd >= 0) { ::close(fd); }
+        }
+
+        ParhipSegmentReader(const ParhipSegmentReader &) = delete;
+
+        ParhipSegmentReader &operator=(const ParhipSegmentReader &) = delete;
+
+        /**
+         * Fills seg with the next vertices, as long as they fit into its
+         * capacity. A single vertex is always read, even if it is larger.
+         * Returns false once all n vertices have been read.
+         */
+        bool next(GraphSegment &seg) {
+            seg.clear();
+            seg.first_vertex = n_read;
+            if (n_read == n) { return false; }
+
+            // byte offsets of the candidate vertices, converted in place
+            const u64 max_vertices = std::min(n - n_read, seg.max_vertices);
+            seg.neighborhoods.resize(max_vertices + 1);
+            pread_all(fd, seg.neighborhoods.data(), (max_vertices + 1) * sizeof(u64), (off_t) ((3 + n_read) * sizeof(u64)));
+            for (u64 i = 0; i <= max_vertices; ++i) {
+                const u64 prev = i == 0 ? prev_offset : seg.neighborhoods[i - 1];
+                if (!valid_parhip_offset(seg.neighborhoods[i], prev, base, m)) {
+                    invalid_parhip_offset(file_path, n_read + i, seg.neighborhoods[i]);
+                }
+            }
+
+            const u64 first = seg.neighborhoods[0];
+            u64 c = 1;
+            while (c < max_vertices && seg.fits(c + 1, (seg.neighborhoods[c + 1] - first) / sizeof(u64))) {
+                ++c;
+            }
+            seg.neighborhoods.resize(c + 1);
+            prev_offset = seg.neighborhoods[c];
+            for (auto &x: seg.neighborhoods) {
+                x = (x - first) / sizeof(u64);
+            }
+
+            const u64 n_edges = seg.neighborhoods[c];
+            seg.edges_v.resize(n_edges);
+            if (n_edges > 0) {
+                pread_all(fd, seg.edges_v.data(), n_edges * sizeof(vertex_t), (off_t) first);
+            }
+
+            // ParHIP graphs are unweighted
+            seg.edges_w.assign(n_edges, 1);
+            seg.v_weights.assign(c, 1);
+            seg.n = c;
+            n_read += c;
+            return true;
+        }
+
+    private:
+        std::string file_path;
+        int fd = -1;
+        u64 base = 0;        // byte offset of the first target
+        u64 prev_offset = 0; // byte offset of vertex n_read
+        u64 n_read = 0;
+    };
+
+    struct OutOfCoreResult {
+        vertex_t n = 0;
+        vertex_t m = 0;
+        weight_t graph_weight = 0;
+        weight_t edge_weight = 0;
+        u64 n_segments = 0;
+        Stats stats;
+        std::vector<u64> partition_weights;
+    };
+
+    /**
+     * Evaluates a graph that does not need to fit into memory. The graph is
+     * read in segments of consecutive vertices by an I/O thread, while the
+     * worker threads evaluate the previous segment. The resident partition,
+     * block weights, read buffers and both segments together stay within
+     * memory_limit bytes. The capacity of a segment is fixed, its buffers
+     * are reused and never grow, except for a single vertex larger than a
+     * segment.
+     */
+    template<typename Reader>
+    inline OutOfCoreResult evaluate_out_of_core(Reader &reader,
+                                                const std::string &partition_path,
+                                                const std::vector<u64> &hierarchy,
+                                                const std::vector<u64> &distance,
+                                                const u64 k,
+                                                const u64 memory_limit,
+                                                const u64 buffer_bytes,
+                                                const u64 n_threads,
+                                                Hotspots *hotspots = nullptr) {
+        OutOfCoreResult res;
+        res.n = reader.n;
+        res.m = reader.m;
+        res.stats = Stats(hierarchy.size());
+        res.partition_weights.resize(k, 0);
+
+        PackedPartition partition(reader.n, k);
+
+        const u64 resident = partition.memory() + k * sizeof(u64) + buffer_bytes;
+        const u64 min_segment_bytes = 1 << 16;
+        if (memory_limit < resident + 2 * min_segment_bytes) {
+            std::cerr << "Memory limit of " << memory_limit << " bytes is too small, at least " << resident + 2 * min_segment_bytes << " bytes are needed!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // the partition is read before the segments are allocated, its
+        // buffer takes their place
+        const u64 partition_buffer_bytes = std::min<u64>(memory_limit - resident, 1 << 20);
+        read_packed_partition(partition_path, partition, k, partition_buffer_bytes);
+
+        // two segments are in flight: one is read, one is evaluated
+        const u64 segment_bytes = (memory_limit - resident) / 2;
+        u64 max_vertices, max_edges;
+        GraphSegment::capacity(segment_bytes, reader.n > 0 ? (f64) reader.m / (f64) reader.n : 0.0, max_vertices, max_edges);
+
+        GraphSegment segments[2];
+        BlockingQueue<GraphSegment *> free_segments, full_segments;
+        for (auto &seg: segments) {
+            seg.reserve(max_vertices, max_edges);
+            free_segments.push(&seg);
+        }
+
+        std::thread io_thread([&]() {
+            while (true) {
+                GraphSegment *seg = free_segments.pop();
+                if (!reader.next(*seg)) {
+                    full_segments.push(nullptr);
+                    return;
+                }
+                full_segments.push(seg);
+            }
+        });
+
+        u64 curr_m = 0;
+        while (GraphSegment *seg = full_segments.pop()) {
+            Stats s = determine_stats_parallel(seg->neighborhoods.data(), seg->edges_v.data(), seg->edges_w.data(), seg->first_vertex, seg->n, partition, hierarchy, distance, n_threads, hotspots);
+            res.stats.merge(s);
+
+            for (u64 u = 0; u < seg->n; ++u) {
+                res.partition_weights[partition[seg->first_vertex + u]] += seg->v_weights[u];
+                res.graph_weight += seg->v_weights[u];
+            }
+            res.edge_weight += sum<weight_t>(seg->edges_w);
+            curr_m += seg->edges_v.size();
+            res.n_segments += 1;
+
+            free_segments.push(seg);
+        }
+        io_thread.join();
+
+        if (curr_m != res.m) {
+            std::cerr << "Number of expected edges " << res.m << " not equal to number edges " << curr_m << " found!\n";
+            exit(EXIT_FAILURE);
+        }
+
+        res.stats.finalize();
+        return res;
+    }
+
+    inline OutOfCoreResult evaluate_out_of_core(const std::string &graph_path,
+                                                const std::string &partition_path,
+                                                const std::vector<u64> &hierarchy,
+                                                const std::vector<u64> &distance,
+                                                const u64 k,
+                                                const u64 memory_limit,
+                                                const u64 n_threads,
+                                                Hotspots *hotspots = nullptr) {
+        if (!file_exists(graph_path)) {
+            std::cerr << "File " << graph_path << " does not exist!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const GraphFormat format = detect_graph_format(graph_path);
+        if (format == GraphFormat::PARHIP) {
+            ParhipSegmentReader reader(graph_path);
+            return evaluate_out_of_core(reader, partition_path, hierarchy, distance, k, memory_limit, 0, n_threads, hotspots);
+        }
+        if (format != GraphFormat::METIS) {
+            std::cerr << "Graphs in " << to_string(format) << " format can not be streamed, only metis and parhip are supported with --memory-limit!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const u64 buffer_bytes = std::clamp<u64>(memory_limit / 16, 1 << 16, 1 << 24);
+        MetisSegmentReader reader(graph_path, buffer_bytes);
+        return evaluate_out_of_core(reader, partition_path, hierarchy, distance, k, memory_limit, buffer_bytes, n_threads, hotspots);
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_OUT_OF_CORE_H
@@ -0,0 +1,159 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_PARALLEL_UTIL_H
+#define PROCESSMAPPINGANALYZER_PARALLEL_UTIL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "definitions.h"
+
+namespace ProMapAnalyzer {
+    inline u64 default_n_threads() {
+        const u64 t = std::thread::hardware_concurrency();
+        return t == 0 ? 1 : t;
+    }
+
+    /**
+     * Calls f(t, bounds[t], bounds[t + 1]) for every range, each on its own
+     * thread. The last range is processed by the calling thread.
+     */
+    template<typename F>
+    inline void parallel_for_ranges(const std::vector<u64> &bounds,
+                                    F &&f) {
+        if (bounds.size() < 2) { return; }
+
+        const u64 n_ranges = bounds.size() - 1;
+        std::vector<std::thread> threads;
+        threads.reserve(n_ranges - 1);
+        for (u64 t = 0; t + 1 < n_ranges; ++t) {
+            threads.emplace_back([&, t]() { f(t, bounds[t], bounds[t + 1]); });
+        }
+        f(n_ranges - 1, bounds[n_ranges - 1], bounds[n_ranges]);
+
+        for (auto &th: threads) {
+            th.join();
+        }
+    }
+
+    /**
+     * Splits [0, n) into n_threads ranges of equal size.
+     */
+    inline std::vector<u64> uniform_ranges(const u64 n,
+                                           const u64 n_threads) {
+        const u64 parts = std::max<u64>(1, std::min(n_threads, n));
+        std::vector<u64> bounds(parts + 1);
+        for (u64 t = 0; t <= parts; ++t) {
+            bounds[t] = n * t / parts;
+        }
+        return bounds;
+    }
+
+    /**
+     * Splits the vertices [0, n) into n_threads ranges such that each range
+     * holds roughly the same number of edges.
+     */
+    inline std::vector<u64> edge_balanced_ranges(const u64 *neighborhoods,
+                                                 const u64 n,
+                                                 const u64 n_threads) {
+        const u64 parts = std::max<u64>(1, std::min(n_threads, n));
+        const u64 m = neighborhoods[n];
+        std::vector<u64> bounds(parts + 1);
+        bounds[0] = 0;
+        for (u64 t = 1; t < parts; ++t) {
+            const u64 target = m * t / parts;
+            const u64 v = (u64) (std::lower_bound(neighborhoods, neighborhoods + n + 1, target) - neighborhoods);
+            bounds[t] = std::max(bounds[t - 1], std::min(v, n));
+        }
+        bounds[parts] = n;
+        return bounds;
+    }
+
+    /**
+     * Unbounded multi-producer multi-consumer queue. pop() blocks until an
+     * element is available.
+     */
+    template<typename T>
+    class BlockingQueue {
+    public:
+        void push(T x) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::move(x));
+            }
+            cv.notify_one();
+        }
+
+        T pop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return !queue.empty(); });
+            T x = std::move(queue.front());
+            queue.pop_front();
+            return x;
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<T> queue;
+    };
+
+    template<typename F>
+    inline void parallel_for(const u64 n,
+                             const u64 n_threads,
+                             F &&f) {
+        parallel_for_ranges(uniform_ranges(n, n_threads), f);
+    }
+
+    /**
+     * Sorts vec with n_threads threads: every thread sorts a range, then the
+     * ranges are merged pairwise, halving their number in every round.
+     */
+    template<typename T, typename Compare>
+    inline void parallel_sort(std::vector<T> &vec,
+                              Compare cmp,
+                              const u64 n_threads) {
+        std::vector<u64> bounds = uniform_ranges(vec.size(), n_threads);
+        parallel_for_ranges(bounds, [&](u64, const u64 begin, const u64 end) {
+            std::sort(vec.begin() + (s64) begin, vec.begin() + (s64) end, cmp);
+        });
+
+        while (bounds.size() > 2) {
+            const u64 n_pairs = (bounds.size() - 1) / 2;
+            std::vector<u64> pairs(n_pairs + 1);
+            for (u64 i = 0; i <= n_pairs; ++i) { pairs[i] = i; }
+
+            parallel_for_ranges(pairs, [&](const u64 i, u64, u64) {
+                std::inplace_merge(vec.begin() + (s64) bounds[2 * i],
+                                   vec.begin() + (s64) bounds[2 * i + 1],
+                                   vec.begin() + (s64) bounds[2 * i + 2],
+                                   cmp);
+            });
+
+            std::vector<u64> merged;
+            for (u64 i = 0; i < bounds.size(); i += 2) { merged.push_back(bounds[i]); }
+            if (merged.back() != bounds.back()) { merged.push_back(bounds.back()); }
+            bounds = std::move(merged);
+        }
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_PARALLEL_UTIL_H
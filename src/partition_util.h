@@ -17,10 +17,14 @@
 #ifndef PROCESSMAPPINGANALYZER_PARTITION_UTIL_H
 #define PROCESSMAPPINGANALYZER_PARTITION_UTIL_H
 
+#include <cmath>
 #include <vector>
 #include <numeric>
 
 #include "graph.h"
+#include "hotspots.h"
+#include "parallel_util.h"
+#include "topology.h"
 
 
 namespace ProMapAnalyzer {
@@ -73,45 +77,106 @@ namespace ProMapAnalyzer {
         abort();
     }
 
-    inline void determine_all_stats(const Graph &g,
-                                    const std::vector<u64> &partition,
-                                    const std::vector<u64> &hierarchy,
-                                    const std::vector<u64> &distance,
-                                    const u64 k,
-                                    u64 &edge_cut,
-                                    u64 &weighted_edge_cut,
-                                    u64 &comm_cost,
-                                    std::vector<u64> &edge_cut_layer,
-                                    std::vector<u64> &weighted_edge_cut_layer,
-                                    std::vector<u64> &comm_cost_layer) {
-        edge_cut = weighted_edge_cut = comm_cost = 0;
+    struct Stats {
+        u64 edge_cut = 0;
+        u64 weighted_edge_cut = 0;
+        u64 comm_cost = 0;
 
-        edge_cut_layer.resize(hierarchy.size());
-        std::fill(edge_cut_layer.begin(), edge_cut_layer.end(), 0);
+        std::vector<u64> edge_cut_layer;
+        std::vector<u64> weighted_edge_cut_layer;
+        std::vector<u64> comm_cost_layer;
 
-        weighted_edge_cut_layer.resize(hierarchy.size());
-        std::fill(weighted_edge_cut_layer.begin(), weighted_edge_cut_layer.end(), 0);
+        explicit Stats(const size_t n_layers = 0) : edge_cut_layer(n_layers, 0),
+                                                    weighted_edge_cut_layer(n_layers, 0),
+                                                    comm_cost_layer(n_layers, 0) {
+        }
 
-        comm_cost_layer.resize(hierarchy.size());
-        std::fill(comm_cost_layer.begin(), comm_cost_layer.end(), 0);
+        void merge(const Stats &other) {
+            edge_cut += other.edge_cut;
+            weighted_edge_cut += other.weighted_edge_cut;
+            comm_cost += other.comm_cost;
+            for (size_t i = 0; i < edge_cut_layer.size(); ++i) {
+                edge_cut_layer[i] += other.edge_cut_layer[i];
+                weighted_edge_cut_layer[i] += other.weighted_edge_cut_layer[i];
+                comm_cost_layer[i] += other.comm_cost_layer[i];
+            }
+        }
 
-        std::vector<u64> loc_distance(hierarchy.size());
-        std::iota(loc_distance.begin(), loc_distance.end(), 0);
+        /**
+         * Every undirected edge is seen from both sides, the cuts are halved.
+         */
+        void finalize() {
+            edge_cut /= 2;
+            for (auto &x: edge_cut_layer) {
+                x /= 2;
+            }
 
-        std::vector<u64> u_loc(hierarchy.size());
-        std::vector<u64> v_loc(hierarchy.size());
+            weighted_edge_cut /= 2;
+            for (auto &x: weighted_edge_cut_layer) {
+                x /= 2;
+            }
+        }
+    };
+
+    /**
+     * Edge weights of a graph whose edges all have weight 1.
+     */
+    struct UnitWeights {
+        weight_t operator[](u64) const { return 1; }
+    };
+
+    /**
+     * Calls f with the edge weights, UnitWeights if edges_w is nullptr.
+     */
+    template<typename F>
+    inline void with_edge_weights(const weight_t *edges_w,
+                                  F &&f) {
+        if (edges_w == nullptr) {
+            f(UnitWeights());
+        } else {
+            f(edges_w);
+        }
+    }
 
-        for (u64 u = 0; u < g.n; ++u) {
-            for (size_t idx = g.neighborhoods[u]; idx < g.neighborhoods[u + 1]; ++idx) {
-                const u64 v = g.edges_v[idx];
-                const u64 weight = g.edges_w[idx];
+    /**
+     * Accumulates the stats of the local vertices [begin, end) of a CSR whose
+     * first vertex has the global id first_vertex. Works on any partition
+     * type that supports operator[] and on any topology, see topology.h.
+     * edges_w is a weight array or UnitWeights.
+     * The collector sees every cut edge and the communication cost of every
+     * vertex, see hotspots.h.
+     */
+    template<typename Weights, typename Topology, typename Partition, typename Collector>
+    inline void accumulate_stats(const u64 *neighborhoods,
+                                 const vertex_t *edges_v,
+                                 const Weights edges_w,
+                                 const u64 first_vertex,
+                                 const u64 begin,
+                                 const u64 end,
+                                 const Partition &partition,
+                                 const Topology &topology,
+                                 Stats &stats,
+                                 Collector &collector) {
+        // kept in locals, the collector may write to memory the compiler can
+        // not tell apart from stats
+        u64 edge_cut = 0, weighted_edge_cut = 0, comm_cost = 0;
+        u64 *edge_cut_layer = stats.edge_cut_layer.data();
+        u64 *weighted_edge_cut_layer = stats.weighted_edge_cut_layer.data();
+        u64 *comm_cost_layer = stats.comm_cost_layer.data();
+
+        for (u64 u = begin; u < end; ++u) {
+            const u64 u_id = partition[first_vertex + u];
+            u64 u_comm_cost = 0, u_edge_cut = 0;
+
+            for (size_t idx = neighborhoods[u]; idx < neighborhoods[u + 1]; ++idx) {
+                const u64 v = edges_v[idx];
+                const u64 weight = edges_w[idx];
 
-                const u64 u_id = partition[u];
                 const u64 v_id = partition[v];
 
                 if (u_id != v_id) {
-                    const u64 u_v_distance = determine_distance(u_id, v_id, k, hierarchy, distance, u_loc, v_loc);
-                    const u64 d = determine_distance(u_id, v_id, k, hierarchy, loc_distance, u_loc, v_loc);
+                    const u64 d = topology.layer(u_id, v_id);
+                    const u64 u_v_distance = topology.distance[d];
 
                     // edge cut
                     edge_cut += 1;
@@ -124,19 +189,105 @@ namespace ProMapAnalyzer {
                     // comm cost
                     comm_cost += weight * u_v_distance;
                     comm_cost_layer[d] += weight * u_v_distance;
+
+                    u_comm_cost += weight * u_v_distance;
+                    u_edge_cut += 1;
+                    collector.edge(first_vertex + u, v, u_id, v_id, d, weight, weight * u_v_distance);
                 }
             }
+            collector.vertex(first_vertex + u, u_id, u_comm_cost, u_edge_cut);
         }
 
-        edge_cut /= 2;
-        for (auto &x: edge_cut_layer) {
-            x /= 2;
+        stats.edge_cut += edge_cut;
+        stats.weighted_edge_cut += weighted_edge_cut;
+        stats.comm_cost += comm_cost;
+    }
+
+    template<typename Weights, typename Topology, typename Partition>
+    inline void accumulate_stats(const u64 *neighborhoods,
+                                 const vertex_t *edges_v,
+                                 const Weights edges_w,
+                                 const u64 first_vertex,
+                                 const u64 begin,
+                                 const u64 end,
+                                 const Partition &partition,
+                                 const Topology &topology,
+                                 Stats &stats) {
+        NoHotspots none;
+        accumulate_stats(neighborhoods, edges_v, edges_w, first_vertex, begin, end, partition, topology, stats, none);
+    }
+
+    /**
+     * Determines the stats of a CSR with n local vertices using n_threads
+     * threads, each accumulating a range of roughly equal edge count. The
+     * kernel is specialized on the hierarchy depth once, before the threads
+     * start.
+     */
+    template<typename Partition>
+    inline Stats determine_stats_parallel(const u64 *neighborhoods,
+                                          const vertex_t *edges_v,
+                                          const weight_t *edges_w, // nullptr for unit weights
+                                          const u64 first_vertex,
+                                          const u64 n,
+                                          const Partition &partition,
+                                          const std::vector<u64> &hierarchy,
+                                          const std::vector<u64> &distance,
+                                          const u64 n_threads,
+                                          Hotspots *hotspots = nullptr) {
+        std::vector<u64> bounds = edge_balanced_ranges(neighborhoods, n, n_threads);
+        std::vector<Stats> local(bounds.size() - 1, Stats(hierarchy.size()));
+
+        if (hotspots == nullptr) {
+            with_edge_weights(edges_w, [&](const auto weights) {
+                with_topology(hierarchy, distance, [&](const auto &topology) {
+                    parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 end) {
+                        accumulate_stats(neighborhoods, edges_v, weights, first_vertex, begin, end, partition, topology, local[t]);
+                    });
+                });
+            });
+        } else {
+            // every thread selects its own top vertices and edges
+            std::vector<Hotspots> local_hotspots(bounds.size() - 1, Hotspots(hotspots->n_hotspots, hotspots->old_of));
+            with_edge_weights(edges_w, [&](const auto weights) {
+                with_topology(hierarchy, distance, [&](const auto &topology) {
+                    parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 end) {
+                        accumulate_stats(neighborhoods, edges_v, weights, first_vertex, begin, end, partition, topology, local[t], local_hotspots[t]);
+                    });
+                });
+            });
+            for (const Hotspots &h: local_hotspots) {
+                hotspots->merge(h);
+            }
         }
 
-        weighted_edge_cut /= 2;
-        for (auto &x: weighted_edge_cut_layer) {
-            x /= 2;
+        Stats stats(hierarchy.size());
+        for (const Stats &s: local) {
+            stats.merge(s);
         }
+        return stats;
+    }
+
+    inline void determine_all_stats(const Graph &g,
+                                    const std::vector<u64> &partition,
+                                    const std::vector<u64> &hierarchy,
+                                    const std::vector<u64> &distance,
+                                    u64 &edge_cut,
+                                    u64 &weighted_edge_cut,
+                                    u64 &comm_cost,
+                                    std::vector<u64> &edge_cut_layer,
+                                    std::vector<u64> &weighted_edge_cut_layer,
+                                    std::vector<u64> &comm_cost_layer,
+                                    const u64 n_threads = 1,
+                                    Hotspots *hotspots = nullptr) {
+        Stats stats = determine_stats_parallel(g.neighborhoods.data(), g.edges_v.data(), g.edge_weights(), 0, g.n, partition, hierarchy, distance, n_threads, hotspots);
+        stats.finalize();
+
+        edge_cut = stats.edge_cut;
+        weighted_edge_cut = stats.weighted_edge_cut;
+        comm_cost = stats.comm_cost;
+        edge_cut_layer = std::move(stats.edge_cut_layer);
+        weighted_edge_cut_layer = std::move(stats.weighted_edge_cut_layer);
+        comm_cost_layer = std::move(stats.comm_cost_layer);
     }
 
     inline std::vector<u64> determine_partition_weights(const Graph &g,
@@ -168,6 +319,95 @@ namespace ProMapAnalyzer {
 
         return partition_balance;
     }
+
+    inline std::vector<f64> determine_partition_balance(const std::vector<u64> &partition_weights,
+                                                        const weight_t g_weight) {
+        const u64 k = partition_weights.size();
+        const f64 balanced_weight = static_cast<f64>(g_weight) / static_cast<f64>(k);
+
+        std::vector<f64> partition_balance(k, 0.0);
+        for (u64 i = 0; i < k; ++i) {
+            partition_balance[i] = static_cast<f64>(partition_weights[i]) / balanced_weight;
+        }
+
+        return partition_balance;
+    }
+
+    // number of overloaded groups listed per level
+    constexpr u64 MAX_LISTED_OVERLOADED = 100;
+
+    struct LevelBalance {
+        u64 n_groups = 0;
+        f64 max_balance = 0.0;
+        f64 min_balance = 0.0;
+        f64 avg_balance = 0.0;
+        f64 L_max = 0.0;
+        u64 max_weight = 0;
+
+        // groups heavier than L_max, the first MAX_LISTED_OVERLOADED are listed
+        u64 n_overloaded = 0;
+        std::vector<u64> overloaded;
+    };
+
+    /**
+     * Balance of the groups on every level of the hierarchy. On level l the
+     * blocks are grouped by block / (a_1 * ... * a_l), level 0 are the
+     * blocks themselves. The group weights of a level are the sums of a_l
+     * consecutive group weights of the level below, so all levels together
+     * take about k additions. Group limits are
+     * L_max = ceil((1 + level_epsilon[l]) * c(V) / n_groups).
+     */
+    inline std::vector<LevelBalance> determine_level_balance(const std::vector<u64> &partition_weights,
+                                                             const weight_t g_weight,
+                                                             const std::vector<u64> &hierarchy,
+                                                             const std::vector<f64> &level_epsilon) {
+        std::vector<LevelBalance> levels(hierarchy.size());
+        std::vector<u64> group_weights;
+
+        const u64 *weights = partition_weights.data();
+        u64 n_groups = partition_weights.size();
+        for (size_t l = 0; l < hierarchy.size(); ++l) {
+            if (l > 0) {
+                // aggregate in place, group i of level l only reads groups >= i of level l - 1
+                const u64 a = hierarchy[l - 1];
+                n_groups /= a;
+                group_weights.resize(std::max<u64>(group_weights.size(), n_groups));
+                for (u64 grp = 0; grp < n_groups; ++grp) {
+                    u64 w = 0;
+                    for (u64 j = 0; j < a; ++j) { w += weights[grp * a + j]; }
+                    group_weights[grp] = w;
+                }
+                weights = group_weights.data();
+            }
+
+            LevelBalance &lb = levels[l];
+            lb.n_groups = n_groups;
+
+            const f64 balanced_weight = static_cast<f64>(g_weight) / static_cast<f64>(n_groups);
+            lb.L_max = ceil((1 + level_epsilon[l]) * balanced_weight);
+            const u64 limit = static_cast<u64>(lb.L_max);
+
+            u64 max_weight = 0, min_weight = weights[0], total_weight = 0;
+            for (u64 grp = 0; grp < n_groups; ++grp) {
+                const u64 w = weights[grp];
+                max_weight = std::max(max_weight, w);
+                min_weight = std::min(min_weight, w);
+                total_weight += w;
+
+                if (w > limit) {
+                    if (lb.n_overloaded < MAX_LISTED_OVERLOADED) { lb.overloaded.push_back(grp); }
+                    ++lb.n_overloaded;
+                }
+            }
+            lb.max_weight = max_weight;
+
+            lb.max_balance = static_cast<f64>(lb.max_weight) / balanced_weight;
+            lb.min_balance = static_cast<f64>(min_weight) / balanced_weight;
+            lb.avg_balance = static_cast<f64>(total_weight) / balanced_weight / static_cast<f64>(n_groups);
+        }
+
+        return levels;
+    }
 }
 
 #endif //PROCESSMAPPINGANALYZER_PARTITION_UTIL_H
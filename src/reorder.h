@@ -0,0 +1,312 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_REORDER_H
+#define PROCESSMAPPINGANALYZER_REORDER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "graph_io.h"
+#include "parallel_util.h"
+
+namespace ProMapAnalyzer {
+    enum class VertexOrder {
+        NONE,
+        BLOCK,
+        RCM,
+        DEGREE
+    };
+
+    inline bool parse_vertex_order(const std::string &str,
+                                   VertexOrder &order) {
+        if (str == "none") {
+            order = VertexOrder::NONE;
+        } else if (str == "block") {
+            order = VertexOrder::BLOCK;
+        } else if (str == "rcm" || str == "bfs") {
+            order = VertexOrder::RCM;
+        } else if (str == "degree") {
+            order = VertexOrder::DEGREE;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Vertices sorted by decreasing degree, ties by id.
+     */
+    inline std::vector<vertex_t> degree_order(const Graph &g,
+                                              const u64 n_threads) {
+        std::vector<vertex_t> old_of(g.n);
+        for (vertex_t u = 0; u < g.n; ++u) { old_of[u] = u; }
+
+        const u64 *nbh = g.neighborhoods.data();
+        parallel_sort(old_of, [&](const vertex_t a, const vertex_t b) {
+            const u64 da = nbh[a + 1] - nbh[a];
+            const u64 db = nbh[b + 1] - nbh[b];
+            return da != db ? da > db : a < b;
+        }, n_threads);
+        return old_of;
+    }
+
+    /**
+     * Vertices grouped by their block, in their original order within a
+     * block. Every edge inside a block then reads the partition close to
+     * its source.
+     */
+    inline std::vector<vertex_t> block_order(const Graph &g,
+                                             const std::vector<u64> &partition,
+                                             const u64 n_threads) {
+        std::vector<vertex_t> old_of(g.n);
+        for (vertex_t u = 0; u < g.n; ++u) { old_of[u] = u; }
+
+        parallel_sort(old_of, [&](const vertex_t a, const vertex_t b) {
+            return partition[a] != partition[b] ? partition[a] < partition[b] : a < b;
+        }, n_threads);
+        return old_of;
+    }
+
+    /**
+     * Reverse Cuthill-McKee: a breadth-first search per connected component,
+     * started at its vertex of smallest degree, that visits the neighbors of
+     * a vertex in order of increasing degree. The order is reversed at the
+     * end. Only the degree sort runs in parallel, the search is sequential.
+     */
+    inline std::vector<vertex_t> rcm_order(const Graph &g,
+                                           const u64 n_threads) {
+        const u64 *nbh = g.neighborhoods.data();
+        auto degree = [&](const vertex_t u) { return nbh[u + 1] - nbh[u]; };
+
+        // candidates for the start of a component, smallest degree first
+        std::vector<vertex_t> starts = degree_order(g, n_threads);
+        std::reverse(starts.begin(), starts.end());
+
+        std::vector<vertex_t> old_of;
+        old_of.reserve(g.n);
+        std::vector<bool> visited(g.n, false);
+        std::vector<vertex_t> next;
+
+        for (const vertex_t s: starts) {
+            if (visited[s]) { continue; }
+            visited[s] = true;
+            old_of.push_back(s);
+
+            // old_of doubles as the queue of the search
+            for (u64 head = old_of.size() - 1; head < old_of.size(); ++head) {
+                const vertex_t u = old_of[head];
+                next.clear();
+                for (u64 idx = nbh[u]; idx < nbh[u + 1]; ++idx) {
+                    const vertex_t v = g.edges_v[idx];
+                    if (!visited[v]) {
+                        visited[v] = true;
+                        next.push_back(v);
+                    }
+                }
+                std::sort(next.begin(), next.end(), [&](const vertex_t a, const vertex_t b) {
+                    return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+                });
+                old_of.insert(old_of.end(), next.begin(), next.end());
+            }
+        }
+
+        std::reverse(old_of.begin(), old_of.end());
+        return old_of;
+    }
+
+    /**
+     * Returns the new order of the vertices, the new vertex u is the old
+     * vertex old_of[u]. Empty for VertexOrder::NONE.
+     */
+    inline std::vector<vertex_t> determine_order(const Graph &g,
+                                                 const std::vector<u64> &partition,
+                                                 const VertexOrder order,
+                                                 const u64 n_threads) {
+        switch (order) {
+            case VertexOrder::NONE: return {};
+            case VertexOrder::BLOCK: return block_order(g, partition, n_threads);
+            case VertexOrder::RCM: return rcm_order(g, n_threads);
+            case VertexOrder::DEGREE: return degree_order(g, n_threads);
+        }
+        return {};
+    }
+
+    /**
+     * Renumbers graph and partition consistently. The stats of the mapping
+     * do not change.
+     */
+    inline void reorder(Graph &g,
+                        std::vector<u64> &partition,
+                        const std::vector<vertex_t> &old_of,
+                        const u64 n_threads) {
+        std::vector<u64> new_partition(g.n);
+        parallel_for(g.n, n_threads, [&](u64, const u64 begin, const u64 end) {
+            for (u64 u = begin; u < end; ++u) {
+                new_partition[u] = partition[old_of[u]];
+            }
+        });
+        partition = std::move(new_partition);
+
+        g.renumber(old_of, n_threads);
+    }
+
+    /**
+     * Buffered writer of decimal numbers.
+     */
+    class NumberWriter {
+    public:
+        explicit NumberWriter(const std::string &path) : file(std::fopen(path.c_str(), "wb")) {
+            if (file == nullptr) {
+                std::cerr << "Could not open " << path << " for writing!" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            buffer.resize(1 << 20);
+        }
+
+        ~NumberWriter() {
+            flush();
+            std::fclose(file);
+        }
+
+        NumberWriter(const NumberWriter &) = delete;
+
+        NumberWriter &operator=(const NumberWriter &) = delete;
+
+        void put(const u64 x) {
+            if (pos + 24 > buffer.size()) { flush(); }
+            pos = (size_t) (std::to_chars(buffer.data() + pos, buffer.data() + buffer.size(), x).ptr - buffer.data());
+        }
+
+        void put(const char c) {
+            if (pos + 1 > buffer.size()) { flush(); }
+            buffer[pos++] = c;
+        }
+
+    private:
+        FILE *file;
+        std::vector<char> buffer;
+        size_t pos = 0;
+
+        void flush() {
+            std::fwrite(buffer.data(), 1, pos, file);
+            pos = 0;
+        }
+    };
+
+    inline void write_partition(const std::vector<u64> &partition,
+                                const std::string &path) {
+        NumberWriter out(path);
+        for (const u64 x: partition) {
+            out.put(x);
+            out.put('\n');
+        }
+    }
+
+    /**
+     * Writes the graph in ParHIP binary format, which stores no weights.
+     */
+    inline void write_parhip(const Graph &g,
+                             const std::string &path) {
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            std::cerr << "Could not open " << path << " for writing!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        const u64 header[3] = {PARHIP_VERSION_UNWEIGHTED, g.n, g.m};
+        std::fwrite(header, sizeof(u64), 3, file);
+
+        const u64 base = PARHIP_HEADER_SIZE + (g.n + 1) * sizeof(u64);
+        std::vector<u64> offsets(g.n + 1);
+        for (vertex_t u = 0; u <= g.n; ++u) {
+            offsets[u] = base + g.neighborhoods[u] * sizeof(u64);
+        }
+        std::fwrite(offsets.data(), sizeof(u64), offsets.size(), file);
+        std::fwrite(g.edges_v.data(), sizeof(vertex_t), g.m, file);
+        std::fclose(file);
+    }
+
+    /**
+     * Writes the graph in METIS format, with vertex and edge weights if they
+     * are not all 1.
+     */
+    inline void write_metis(const Graph &g,
+                            const std::string &path) {
+        const bool has_v_weights = std::any_of(g.v_weights.begin(), g.v_weights.end(), [](const weight_t w) { return w != 1; });
+        const bool has_e_weights = !g.unit_edge_weights && std::any_of(g.edges_w.begin(), g.edges_w.end(), [](const weight_t w) { return w != 1; });
+
+        NumberWriter out(path);
+        out.put(g.n);
+        out.put(' ');
+        out.put(g.m / 2);
+        if (has_v_weights || has_e_weights) {
+            out.put(' ');
+            out.put(has_v_weights ? '1' : '0');
+            out.put(has_e_weights ? '1' : '0');
+        }
+        out.put('\n');
+
+        for (vertex_t u = 0; u < g.n; ++u) {
+            bool first = true;
+            if (has_v_weights) {
+                out.put((u64) g.v_weights[u]);
+                first = false;
+            }
+            for (u64 idx = g.neighborhoods[u]; idx < g.neighborhoods[u + 1]; ++idx) {
+                if (!first) { out.put(' '); }
+                out.put(g.edges_v[idx] + 1);
+                if (has_e_weights) {
+                    out.put(' ');
+                    out.put((u64) g.edge_weight(idx));
+                }
+                first = false;
+            }
+            out.put('\n');
+        }
+    }
+
+    /**
+     * Stores graph and partition for later evaluations: prefix.bin in ParHIP
+     * format if the graph is unweighted and prefix.graph in METIS format
+     * otherwise, and prefix.part. Returns the path of the graph.
+     */
+    inline std::string write_graph_cache(const Graph &g,
+                                         const std::vector<u64> &partition,
+                                         const std::string &prefix) {
+        const bool unweighted = std::all_of(g.v_weights.begin(), g.v_weights.end(), [](const weight_t w) { return w == 1; }) &&
+                                (g.unit_edge_weights || std::all_of(g.edges_w.begin(), g.edges_w.end(), [](const weight_t w) { return w == 1; }));
+
+        std::string graph_path;
+        if (unweighted) {
+            graph_path = prefix + ".bin";
+            write_parhip(g, graph_path);
+        } else {
+            graph_path = prefix + ".graph";
+            write_metis(g, graph_path);
+        }
+        write_partition(partition, prefix + ".part");
+        return graph_path;
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_REORDER_H
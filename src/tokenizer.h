@@ -0,0 +1,310 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_TOKENIZER_H
+#define PROCESSMAPPINGANALYZER_TOKENIZER_H
+
+#include <array>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "definitions.h"
+
+namespace ProMapAnalyzer {
+    /**
+     * Whitespace inside a line: space, tab, carriage return, vertical tab
+     * and form feed. The newline is handled separately.
+     */
+    inline bool is_space(const char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool is_digit(const char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    inline u32 count_trailing_zeros(const u64 x) {
+        return (u32) __builtin_ctzll(x);
+    }
+
+    /**
+     * Classification of the 64 bytes of a block, bit i belongs to byte i.
+     */
+    struct BlockMasks {
+        u64 digits = 0;
+        u64 newlines = 0;
+        u64 others = 0; // neither digit, whitespace nor newline
+    };
+
+    #if defined(__AVX2__)
+    inline void classify_32(const char *p,
+                            u32 &digits,
+                            u32 &newlines,
+                            u32 &others) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+
+        const __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+        const __m256i is_d = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        const __m256i is_nl = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'));
+
+        // ' ' and '\t', '\v', '\f', '\r' (0x09, 0x0b - 0x0d)
+        __m256i is_s = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' '));
+        is_s = _mm256_or_si256(is_s, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t')));
+        const __m256i y = _mm256_sub_epi8(x, _mm256_set1_epi8(0x0b));
+        is_s = _mm256_or_si256(is_s, _mm256_cmpeq_epi8(_mm256_min_epu8(y, _mm256_set1_epi8(2)), y));
+
+        digits = (u32) _mm256_movemask_epi8(is_d);
+        newlines = (u32) _mm256_movemask_epi8(is_nl);
+        others = ~(digits | newlines | (u32) _mm256_movemask_epi8(is_s));
+    }
+    #elif defined(__SSE2__)
+    inline void classify_16(const char *p,
+                            u32 &digits,
+                            u32 &newlines,
+                            u32 &others) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+        const __m128i d = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+        const __m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+        const __m128i is_nl = _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'));
+
+        __m128i is_s = _mm_cmpeq_epi8(x, _mm_set1_epi8(' '));
+        is_s = _mm_or_si128(is_s, _mm_cmpeq_epi8(x, _mm_set1_epi8('\t')));
+        const __m128i y = _mm_sub_epi8(x, _mm_set1_epi8(0x0b));
+        is_s = _mm_or_si128(is_s, _mm_cmpeq_epi8(_mm_min_epu8(y, _mm_set1_epi8(2)), y));
+
+        digits = (u32) _mm_movemask_epi8(is_d);
+        newlines = (u32) _mm_movemask_epi8(is_nl);
+        others = ~(digits | newlines | (u32) _mm_movemask_epi8(is_s)) & 0xFFFF;
+    }
+    #endif
+
+    /**
+     * Classifies the 64 bytes at p, all of which must be readable.
+     */
+    inline BlockMasks classify_64(const char *p) {
+        BlockMasks b;
+        #if defined(__AVX2__)
+        for (int i = 0; i < 2; ++i) {
+            u32 d, nl, o;
+            classify_32(p + 32 * i, d, nl, o);
+            b.digits |= (u64) d << (32 * i);
+            b.newlines |= (u64) nl << (32 * i);
+            b.others |= (u64) o << (32 * i);
+        }
+        #elif defined(__SSE2__)
+        for (int i = 0; i < 4; ++i) {
+            u32 d, nl, o;
+            classify_16(p + 16 * i, d, nl, o);
+            b.digits |= (u64) d << (16 * i);
+            b.newlines |= (u64) nl << (16 * i);
+            b.others |= (u64) o << (16 * i);
+        }
+        #else
+        for (int i = 0; i < 64; ++i) {
+            const u64 bit = 1ULL << i;
+            if (is_digit(p[i])) {
+                b.digits |= bit;
+            } else if (p[i] == '\n') {
+                b.newlines |= bit;
+            } else if (!is_space(p[i])) {
+                b.others |= bit;
+            }
+        }
+        #endif
+        return b;
+    }
+
+    /**
+     * Converts exactly l <= 8 digits at p with three multiply-adds on a 64 bit
+     * word (digit pairs, groups of 4, group of 8). 8 bytes at p must be
+     * readable.
+     */
+    inline u64 parse_digits_8(const char *p,
+                              const u32 l) {
+        u64 x;
+        std::memcpy(&x, p, 8);
+        x -= 0x3030303030303030ULL;
+        x <<= 8 * (8 - l); // leading zeros, drops the bytes behind the run
+
+        x = ((x & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        x = ((x & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        x = ((x & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+        return x;
+    }
+
+    #if defined(__SSE4_1__)
+    /**
+     * pshufb masks that move the first l bytes of a vector to its end and
+     * fill the front with zeros.
+     */
+    constexpr std::array<std::array<u8, 16>, 17> make_digit_shuffles() {
+        std::array<std::array<u8, 16>, 17> t{};
+        for (int l = 0; l <= 16; ++l) {
+            for (int j = 0; j < 16; ++j) {
+                const int src = j - (16 - l);
+                t[l][j] = src < 0 ? 0x80 : (u8) src;
+            }
+        }
+        return t;
+    }
+
+    alignas(16) constexpr std::array<std::array<u8, 16>, 17> DIGIT_SHUFFLES = make_digit_shuffles();
+    #endif
+
+    /**
+     * Converts exactly l <= 16 digits at p. 16 bytes at p must be readable.
+     */
+    inline u64 parse_digits_16(const char *p,
+                               const u32 l) {
+        #if defined(__SSE4_1__)
+        const __m128i digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), _mm_set1_epi8('0'));
+        const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i *>(DIGIT_SHUFFLES[l].data()));
+        const __m128i x = _mm_shuffle_epi8(digits, shuffle);
+
+        const __m128i t1 = _mm_maddubs_epi16(x, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+        const __m128i t2 = _mm_madd_epi16(t1, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+        const __m128i t3 = _mm_packus_epi32(t2, t2);
+        const __m128i t4 = _mm_madd_epi16(t3, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+        const u64 hi = (u32) _mm_cvtsi128_si32(t4);
+        const u64 lo = (u32) _mm_extract_epi32(t4, 1);
+        return hi * 100000000ULL + lo;
+        #else
+        if (l <= 8) { return parse_digits_8(p, l); }
+        return parse_digits_8(p, l - 8) * 100000000ULL + parse_digits_8(p + l - 8, 8);
+        #endif
+    }
+
+    /**
+     * Parses the digit run at p of any length and advances p behind it.
+     */
+    inline u64 parse_uint(const char *&p,
+                          const char *end) {
+        u64 x = 0;
+        while (p < end && is_digit(*p)) {
+            x = x * 10 + (u64) (*p - '0');
+            ++p;
+        }
+        return x;
+    }
+
+    /**
+     * Returns the first position in [p, end) that is not whitespace. Newlines
+     * are not skipped.
+     */
+    inline const char *skip_spaces(const char *p,
+                                   const char *end) {
+        while (p < end && is_space(*p)) { ++p; }
+        return p;
+    }
+
+    /**
+     * Returns the position of the next newline in [p, end) or end.
+     */
+    inline const char *find_newline(const char *p,
+                                    const char *end) {
+        const void *nl = std::memchr(p, '\n', (size_t) (end - p));
+        return nl == nullptr ? end : static_cast<const char *>(nl);
+    }
+
+    /**
+     * Returns the position after the next newline in [p, end) or end.
+     */
+    inline const char *skip_line(const char *p,
+                                 const char *end) {
+        const char *nl = find_newline(p, end);
+        return nl == end ? end : nl + 1;
+    }
+
+    /**
+     * Calls on_uint(x) for every unsigned integer in the line starting at p,
+     * 64 bytes at a time: the block is classified into bitmasks, digit runs
+     * are found from the masks and converted by their known length.
+     * Returns the position behind the newline, or end. If the line contains
+     * a character that is neither digit nor whitespace, *invalid is set to it
+     * and the rest of the line is skipped.
+     */
+    template<typename F>
+    inline const char *scan_uint_line(const char *p,
+                                      const char *end,
+                                      const char **invalid,
+                                      F &&on_uint) {
+        // the tail of the buffer is copied, so all loads stay in bounds
+        alignas(64) char tail[64 + 16];
+
+        while (p < end) {
+            const char *b = p;
+            u64 valid = ~0ULL;
+            if (end - p < 64 + 16) {
+                const size_t l = std::min<size_t>(end - p, 64);
+                std::memcpy(tail, p, l);
+                std::memset(tail + l, '\n', sizeof(tail) - l);
+                b = tail;
+                valid = l == 64 ? ~0ULL : (1ULL << l) - 1;
+            }
+
+            const BlockMasks masks = classify_64(b);
+            const u64 nl = masks.newlines & valid;
+            const u64 line = nl == 0 ? valid : (nl & (0 - nl)) - 1; // bytes before the newline
+
+            if (masks.others & line) {
+                *invalid = p + count_trailing_zeros(masks.others & line);
+                return skip_line(p, end);
+            }
+
+            const u64 digits = masks.digits & line;
+            u64 starts = digits & ~(digits << 1);
+            while (starts != 0) {
+                const u32 i = count_trailing_zeros(starts);
+                const u64 after = ~(digits >> i);
+                const u32 l = after == 0 ? 64 - i : count_trailing_zeros(after);
+
+                if (i + l == 64) {
+                    // run reaches the end of the block, finish it bytewise
+                    // and continue with a new block behind it
+                    const char *q = p + i;
+                    on_uint(parse_uint(q, end));
+                    p = q;
+                    goto next_block;
+                }
+
+                if (l <= 8) {
+                    on_uint(parse_digits_8(b + i, l));
+                } else if (l <= 16) {
+                    on_uint(parse_digits_16(b + i, l));
+                } else {
+                    const char *q = p + i;
+                    on_uint(parse_uint(q, end));
+                }
+                starts &= starts - 1;
+            }
+
+            if (nl != 0) {
+                return p + count_trailing_zeros(nl) + 1;
+            }
+            p += 64;
+            if (p > end) { p = end; }
+            next_block:;
+        }
+        return end;
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_TOKENIZER_H
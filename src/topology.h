@@ -0,0 +1,136 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_TOPOLOGY_H
+#define PROCESSMAPPINGANALYZER_TOPOLOGY_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "definitions.h"
+
+namespace ProMapAnalyzer {
+    // deepest hierarchy with a specialized kernel
+    constexpr size_t MAX_STATIC_DEPTH = 6;
+
+    __extension__ typedef unsigned __int128 u128;
+
+    /**
+     * Hierarchy of fixed depth D. Block p lies in group p / strides[l] on
+     * level l, where strides[l] is the product of the first l hierarchy
+     * entries. Two different blocks are separated on the highest level on
+     * which their groups differ, this is their layer.
+     *
+     * Block ids have to fit into 32 bits and strides[l] >= 2 for l >= 1,
+     * see fits_static_topology. The divisions are then replaced by a
+     * multiplication with the precomputed reciprocal ceil(2^64 / stride)
+     * (Lemire et al., "Faster Remainder by Direct Computation").
+     */
+    template<size_t D>
+    struct StaticTopology {
+        std::array<u64, D> reciprocals{};
+        std::array<u64, D> distance{};
+
+        StaticTopology(const std::vector<u64> &hierarchy,
+                       const std::vector<u64> &t_distance) {
+            u64 stride = 1;
+            for (size_t l = 0; l < D; ++l) {
+                // wraps to 0 for the stride 1 of level 0, which is never used
+                reciprocals[l] = UINT64_MAX / stride + 1;
+                distance[l] = t_distance[l];
+                stride *= hierarchy[l];
+            }
+        }
+
+        static constexpr size_t depth() { return D; }
+
+        u64 group(const u64 p_id,
+                  const size_t l) const {
+            return (u64) (((u128) reciprocals[l] * p_id) >> 64);
+        }
+
+        /**
+         * Layer of two different blocks. Groups are nested, so the search
+         * stops at the first level on which both blocks share a group.
+         */
+        u64 layer(const u64 u_id,
+                  const u64 v_id) const {
+            for (size_t l = 1; l < D; ++l) {
+                if (group(u_id, l) == group(v_id, l)) { return l - 1; }
+            }
+            return D - 1;
+        }
+    };
+
+    /**
+     * Fallback for hierarchies deeper than MAX_STATIC_DEPTH, with a level of
+     * size 1 at the bottom or with more than 2^32 blocks.
+     */
+    struct DynamicTopology {
+        std::vector<u64> strides;
+        std::vector<u64> distance;
+
+        DynamicTopology(const std::vector<u64> &hierarchy,
+                        const std::vector<u64> &t_distance) : strides(hierarchy.size()), distance(t_distance) {
+            u64 stride = 1;
+            for (size_t l = 0; l < hierarchy.size(); ++l) {
+                strides[l] = stride;
+                stride *= hierarchy[l];
+            }
+        }
+
+        size_t depth() const { return strides.size(); }
+
+        u64 layer(const u64 u_id,
+                  const u64 v_id) const {
+            const size_t s = strides.size();
+            for (size_t l = 1; l < s; ++l) {
+                if (u_id / strides[l] == v_id / strides[l]) { return l - 1; }
+            }
+            return s - 1;
+        }
+    };
+
+    inline bool fits_static_topology(const std::vector<u64> &hierarchy) {
+        u64 k = 1;
+        for (const u64 x: hierarchy) { k *= x; }
+        return hierarchy.size() <= MAX_STATIC_DEPTH && hierarchy[0] >= 2 && k <= UINT32_MAX;
+    }
+
+    /**
+     * Calls f with the topology of the hierarchy, specialized on its depth if
+     * possible, see fits_static_topology.
+     */
+    template<typename F>
+    inline decltype(auto) with_topology(const std::vector<u64> &hierarchy,
+                                        const std::vector<u64> &distance,
+                                        F &&f) {
+        if (!fits_static_topology(hierarchy)) { return f(DynamicTopology(hierarchy, distance)); }
+
+        switch (hierarchy.size()) {
+            case 1: return f(StaticTopology<1>(hierarchy, distance));
+            case 2: return f(StaticTopology<2>(hierarchy, distance));
+            case 3: return f(StaticTopology<3>(hierarchy, distance));
+            case 4: return f(StaticTopology<4>(hierarchy, distance));
+            case 5: return f(StaticTopology<5>(hierarchy, distance));
+            case 6: return f(StaticTopology<6>(hierarchy, distance));
+            default: return f(DynamicTopology(hierarchy, distance));
+        }
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_TOPOLOGY_H
@@ -144,6 +144,34 @@ namespace ProMapAnalyzer {
         return oss.str();
     }
 
+    /**
+     * The string as a quoted JSON string, with quotes, backslashes and
+     * control characters escaped.
+     */
+    inline std::string stringToJson(const std::string &str) {
+        std::ostringstream oss;
+        oss << "\"";
+        for (const char c: str) {
+            switch (c) {
+                case '"': oss << "\\\""; break;
+                case '\\': oss << "\\\\"; break;
+                case '\b': oss << "\\b"; break;
+                case '\f': oss << "\\f"; break;
+                case '\n': oss << "\\n"; break;
+                case '\r': oss << "\\r"; break;
+                case '\t': oss << "\\t"; break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+                    } else {
+                        oss << c;
+                    }
+            }
+        }
+        oss << "\"";
+        return oss.str();
+    }
+
     inline void line_to_ints(const std::string &line,
                              std::vector<u64> &ints) {
         ints.clear();
@@ -189,6 +217,27 @@ namespace ProMapAnalyzer {
         return splits;
     }
 
+    /**
+     * Parses a byte count with an optional binary suffix, e.g. 512M or 4G.
+     * Returns 0 if the string is not a valid size.
+     */
+    inline u64 parse_bytes(const std::string &str) {
+        u64 value = 0;
+        const char *begin = str.data();
+        const char *end = begin + str.size();
+        auto res = std::from_chars(begin, end, value);
+        if (res.ec != std::errc() || res.ptr == begin) { return 0; }
+
+        std::string suffix(res.ptr, end);
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::toupper);
+        if (suffix.empty() || suffix == "B") { return value; }
+        if (suffix == "K" || suffix == "KB" || suffix == "KIB") { return value << 10; }
+        if (suffix == "M" || suffix == "MB" || suffix == "MIB") { return value << 20; }
+        if (suffix == "G" || suffix == "GB" || suffix == "GIB") { return value << 30; }
+        if (suffix == "T" || suffix == "TB" || suffix == "TIB") { return value << 40; }
+        return 0;
+    }
+
     inline std::vector<u64> read_partition(const std::string &path, const size_t n) {
         if (!file_exists(path)) {
             std::cerr << "File " << path << " does not exist!" << std::endl;
@@ -322,6 +371,55 @@ namespace ProMapAnalyzer {
         out_file.close();
     }
 
+    /**
+     * Contiguous array that either owns its elements or refers to memory
+     * owned by someone else, e.g. a mapped file.
+     */
+    template<typename T>
+    class Array {
+    public:
+        void resize(const size_t n) {
+            owned.resize(n);
+            ptr = owned.data();
+            len = n;
+        }
+
+        void assign(std::vector<T> &&vec) {
+            owned = std::move(vec);
+            ptr = owned.data();
+            len = owned.size();
+        }
+
+        void borrow(T *p, const size_t n) {
+            owned = std::vector<T>();
+            ptr = p;
+            len = n;
+        }
+
+        T &operator[](const size_t i) { return ptr[i]; }
+
+        const T &operator[](const size_t i) const { return ptr[i]; }
+
+        T *data() { return ptr; }
+
+        const T *data() const { return ptr; }
+
+        size_t size() const { return len; }
+
+        T *begin() { return ptr; }
+
+        T *end() { return ptr + len; }
+
+        const T *begin() const { return ptr; }
+
+        const T *end() const { return ptr + len; }
+
+    private:
+        std::vector<T> owned;
+        T *ptr = nullptr;
+        size_t len = 0;
+    };
+
     // Suggested shape of your helper
     struct MMap {
         char *data = nullptr;
@@ -367,6 +465,62 @@ namespace ProMapAnalyzer {
         return mm;
     }
 
+    /**
+     * Maps a file read-only without access hints: pages are only read once
+     * they are touched.
+     */
+    inline MMap mmap_file_lazy(const std::string &path) {
+        MMap mm;
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            perror("open");
+            std::exit(EXIT_FAILURE);
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            perror("fstat");
+            std::exit(EXIT_FAILURE);
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+
+        void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("mmap");
+            std::exit(EXIT_FAILURE);
+        }
+
+        mm.data = static_cast<char *>(addr);
+        mm.size = size;
+        mm.fd = fd;
+        return mm;
+    }
+
+    /**
+     * Reads exactly size bytes at offset, retrying on short reads.
+     */
+    inline void pread_all(const int fd,
+                          void *buf,
+                          size_t size,
+                          off_t offset) {
+        char *p = static_cast<char *>(buf);
+        while (size > 0) {
+            const ssize_t r = ::pread(fd, p, size, offset);
+            if (r < 0) {
+                perror("pread");
+                std::exit(EXIT_FAILURE);
+            }
+            if (r == 0) {
+                std::cerr << "Unexpected end of file!" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            p += r;
+            size -= (size_t) r;
+            offset += r;
+        }
+    }
+
     inline void munmap_file(const MMap &mm) {
         if (mm.data && mm.size) ::munmap(mm.data, mm.size);
         if (mm.fd >= 0) ::close(mm.fd);
@@ -0,0 +1,262 @@
+/* Process Mapping Analyzer.
+   Copyright (C) 2024  Henning Woydt
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or any
+   later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==============================================================================*/
+#ifndef PROCESSMAPPINGANALYZER_VALIDATE_H
+#define PROCESSMAPPINGANALYZER_VALIDATE_H
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+#include "parallel_util.h"
+#include "util.h"
+
+namespace ProMapAnalyzer {
+    // number of offending vertices reported per kind of defect
+    constexpr u64 VALIDATE_N_EXAMPLES = 10;
+
+    /**
+     * Number of offending directed edges of one kind and the smallest
+     * vertices they start at.
+     */
+    struct Defect {
+        u64 count = 0;
+        std::vector<vertex_t> first_vertices;
+
+        void add(const vertex_t u) {
+            if (count == 0 || first_vertices.back() != u) {
+                if (first_vertices.size() < VALIDATE_N_EXAMPLES) { first_vertices.push_back(u); }
+            }
+            ++count;
+        }
+
+        /**
+         * Appends the defects of a later vertex range.
+         */
+        void merge(const Defect &other) {
+            count += other.count;
+            for (const vertex_t u: other.first_vertices) {
+                if (first_vertices.size() < VALIDATE_N_EXAMPLES) { first_vertices.push_back(u); }
+            }
+        }
+    };
+
+    struct ValidationReport {
+        Defect out_of_range;
+        Defect self_loops;
+        Defect duplicates;
+        Defect asymmetric;
+        Defect weight_mismatches;
+
+        bool valid() const {
+            return out_of_range.count == 0 && self_loops.count == 0 && duplicates.count == 0 &&
+                   asymmetric.count == 0 && weight_mismatches.count == 0;
+        }
+
+        void merge(const ValidationReport &other) {
+            out_of_range.merge(other.out_of_range);
+            self_loops.merge(other.self_loops);
+            duplicates.merge(other.duplicates);
+            asymmetric.merge(other.asymmetric);
+            weight_mismatches.merge(other.weight_mismatches);
+        }
+    };
+
+    inline u64 mix_hash(u64 x) {
+        // splitmix64 finalizer
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    inline u64 edge_hash(const vertex_t v,
+                         const weight_t w) {
+        return mix_hash(v ^ mix_hash((u64) w));
+    }
+
+    /**
+     * Hash of the directed edge (u, v) of weight w, differs from the hash of
+     * (v, u).
+     */
+    inline u64 directed_edge_hash(const vertex_t u,
+                                  const vertex_t v,
+                                  const weight_t w) {
+        return mix_hash(mix_hash(u) ^ edge_hash(v, w));
+    }
+
+    /**
+     * Checks the adjacency of g for neighbor ids >= n, self-loops, duplicate
+     * edges, edges without reverse edge and reverse edges of different
+     * weight. Every count is in directed edges, attributed to their source.
+     *
+     * Duplicates are found on a sorted copy of every neighborhood. For the
+     * symmetry every edge (u, v, w) adds hash(u, v, w) - hash(v, u, w) to a
+     * fingerprint, so a symmetric graph sums to 0 and one sweep without
+     * shared writes suffices. Otherwise the defects are located: every
+     * vertex sums a hash of (neighbor, weight) over its edges and a hash of
+     * (source, weight) over the edges pointing to it. Only vertices whose
+     * sums differ can have a missing or different reverse edge, their edges
+     * are then checked exactly by a binary search in a sorted copy of the
+     * neighborhood at the other end.
+     */
+    inline ValidationReport validate_graph(const Graph &g,
+                                           const u64 n_threads) {
+        const vertex_t n = g.n;
+        const u64 *nbh = g.neighborhoods.data();
+
+        const std::vector<u64> bounds = edge_balanced_ranges(nbh, n, n_threads);
+        std::vector<ValidationReport> local(bounds.size() - 1);
+        std::vector<u64> fingerprints(bounds.size() - 1, 0);
+
+        parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 end) {
+            ValidationReport &r = local[t];
+            std::vector<vertex_t> sorted;
+            u64 fingerprint = 0;
+
+            for (u64 u = begin; u < end; ++u) {
+                sorted.clear();
+                for (u64 idx = nbh[u]; idx < nbh[u + 1]; ++idx) {
+                    const vertex_t v = g.edges_v[idx];
+                    const weight_t w = g.edge_weight(idx);
+                    if (v >= n) {
+                        r.out_of_range.add(u);
+                        continue;
+                    }
+                    if (v == u) { r.self_loops.add(u); }
+
+                    fingerprint += directed_edge_hash(u, v, w) - directed_edge_hash(v, u, w);
+                    sorted.push_back(v);
+                }
+
+                if (!std::is_sorted(sorted.begin(), sorted.end())) { std::sort(sorted.begin(), sorted.end()); }
+                for (size_t i = 1; i < sorted.size(); ++i) {
+                    if (sorted[i] == sorted[i - 1]) { r.duplicates.add(u); }
+                }
+            }
+            fingerprints[t] = fingerprint;
+        });
+
+        if (sum<u64>(fingerprints) != 0) {
+            std::vector<u64> out_sum(n, 0);
+            std::vector<std::atomic<u64> > in_sum(n);
+            for (auto &x: in_sum) { x.store(0, std::memory_order_relaxed); }
+
+            parallel_for_ranges(bounds, [&](u64, const u64 begin, const u64 end) {
+                for (u64 u = begin; u < end; ++u) {
+                    u64 s = 0;
+                    for (u64 idx = nbh[u]; idx < nbh[u + 1]; ++idx) {
+                        const vertex_t v = g.edges_v[idx];
+                        const weight_t w = g.edge_weight(idx);
+                        if (v >= n) { continue; }
+
+                        s += edge_hash(v, w);
+                        in_sum[v].fetch_add(edge_hash(u, w), std::memory_order_relaxed);
+                    }
+                    out_sum[u] = s;
+                }
+            });
+
+            std::vector<u8> flagged(n, 0), needed(n, 0);
+            parallel_for_ranges(bounds, [&](u64, const u64 begin, const u64 end) {
+                for (u64 u = begin; u < end; ++u) {
+                    flagged[u] = out_sum[u] != in_sum[u].load(std::memory_order_relaxed);
+                }
+            });
+            for (u64 u = 0; u < n; ++u) {
+                if (!flagged[u]) { continue; }
+                for (u64 idx = nbh[u]; idx < nbh[u + 1]; ++idx) {
+                    if (g.edges_v[idx] < n) { needed[g.edges_v[idx]] = 1; }
+                }
+            }
+
+            // sorted (neighbor, weight) copies of the neighborhoods the
+            // reverse edges are searched in
+            std::vector<u64> offsets(n + 1, 0);
+            for (u64 v = 0; v < n; ++v) {
+                offsets[v + 1] = offsets[v] + (needed[v] ? nbh[v + 1] - nbh[v] : 0);
+            }
+            std::vector<std::pair<vertex_t, weight_t> > sorted_edges(offsets[n]);
+            parallel_for_ranges(bounds, [&](u64, const u64 begin, const u64 end) {
+                for (u64 v = begin; v < end; ++v) {
+                    if (!needed[v]) { continue; }
+                    for (u64 idx = nbh[v]; idx < nbh[v + 1]; ++idx) {
+                        sorted_edges[offsets[v] + idx - nbh[v]] = {g.edges_v[idx], g.edge_weight(idx)};
+                    }
+                    std::sort(sorted_edges.begin() + (s64) offsets[v], sorted_edges.begin() + (s64) offsets[v + 1]);
+                }
+            });
+
+            // exact check of the edges of the flagged vertices
+            parallel_for_ranges(bounds, [&](const u64 t, const u64 begin, const u64 end) {
+                ValidationReport &r = local[t];
+
+                for (u64 u = begin; u < end; ++u) {
+                    if (!flagged[u]) { continue; }
+
+                    for (u64 idx = nbh[u]; idx < nbh[u + 1]; ++idx) {
+                        const vertex_t v = g.edges_v[idx];
+                        const weight_t w = g.edge_weight(idx);
+                        if (v >= n) { continue; }
+
+                        const auto first = sorted_edges.begin() + (s64) offsets[v];
+                        const auto last = sorted_edges.begin() + (s64) offsets[v + 1];
+                        const auto it = std::lower_bound(first, last, std::make_pair(u, w));
+                        const bool same_weight = it != last && it->first == u && it->second == w;
+                        const bool found = same_weight || (it != last && it->first == u) || (it != first && std::prev(it)->first == u);
+
+                        if (!found) {
+                            r.asymmetric.add(u);
+                        } else if (!same_weight) {
+                            r.weight_mismatches.add(u);
+                        }
+                    }
+                }
+            });
+        }
+
+        ValidationReport report;
+        for (const ValidationReport &r: local) {
+            report.merge(r);
+        }
+        return report;
+    }
+
+    inline std::string defectToString(const std::string &name,
+                                      const Defect &d) {
+        return name + ": " + std::to_string(d.count) + (d.count > 0 ? " (first vertices " + vectorToString(d.first_vertices) + ")" : "");
+    }
+
+    /**
+     * Prints the report, one line per kind of defect.
+     */
+    inline void print_validation_report(const ValidationReport &r) {
+        std::cout << "Graph validation: " << (r.valid() ? "valid" : "invalid") << "\n"
+                  << "  " << defectToString("out-of-range neighbors", r.out_of_range) << "\n"
+                  << "  " << defectToString("self-loops", r.self_loops) << "\n"
+                  << "  " << defectToString("duplicate edges", r.duplicates) << "\n"
+                  << "  " << defectToString("edges without reverse edge", r.asymmetric) << "\n"
+                  << "  " << defectToString("reverse edges with different weight", r.weight_mismatches) << std::endl;
+    }
+}
+
+#endif //PROCESSMAPPINGANALYZER_VALIDATE_H